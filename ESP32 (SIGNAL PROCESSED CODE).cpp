@@ -1,102 +1,113 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+
+#include "dsp/calibration.h"
+#include "dsp/file_spool.h"
+#include "dsp/leak_detector.h"
+#include "dsp/pipeline.h"
+#include "dsp/report_by_exception.h"
+#include "dsp/transmit.h"
+
+using namespace leakdsp;
 
 const char* ssid = "realme 8 5G";
 const char* password = "2yg4ysmr";
-const char* serverName = "http://192.168.242.192:5000/api/data";
+const char* serverName = "http://192.168.242.192:5000/api/data/batch";
+const char* captureUrl = "http://192.168.242.192:5000/api/captures";
 
 // Sensor pins
 const int piezoPin1 = 35;
 const int piezoPin2 = 34;
 const int piezoPin3 = 39;
-const int numSensors = 3;
 const int sensorPins[numSensors] = {piezoPin1, piezoPin2, piezoPin3};
 
-// 🏗️ REAL-WORLD MUNICIPAL PIPELINE BURST DETECTION PARAMETERS
-// Based on research: Underground pipeline bursts generate 50-200+ Hz vibrations
-// with amplitudes typically 10-100x higher than normal flow conditions
+// Detection parameters and the detector itself live in dsp/ so the same code
+// can be replayed and profiled on a host (see dsp/CMakeLists.txt).
 
-// REALISTIC THRESHOLDS FOR MUNICIPAL PIPELINE BURSTS
-const int normalFlowThreshold = 15;        // Normal water flow vibration (15-30 range)
-const int leakThreshold = 45;              // Small leak detection (45-80 range)
-const int burstThreshold = 120;            // Pipeline burst detection (120-300+ range)
-const int catastrophicBurstThreshold = 250; // Major burst/pipe rupture (250+ range)
-
-// 🔥 ADVANCED FILTERING FOR REAL-WORLD CONDITIONS
-const int signalWindow = 50;               // Larger window for burst pattern analysis
-const int noiseWindow = 150;               // Extended noise baseline for urban environments
-const float adaptiveMultiplier = 2.5;      // Conservative threshold for urban noise
-const int requiredConsecutive = 6;         // Faster response for burst detection
-const int minLeakDuration = 300;           // Shorter duration for burst response
-const int burstResponseTime = 150;         // Very fast burst response (150ms)
+// Board bindings for the detector
+class ArduinoClock : public Clock {
+public:
+  uint32_t nowMs() { return millis(); }
+};
 
-// 🎯 PRECISION FILTERS FOR MUNICIPAL ENVIRONMENT
-const float sensorAgreementThreshold = 0.5;  // 50% sensor agreement (urban noise)
-const int vibrationCooldown = 1500;          // 1.5-second cooldown after high vibration
-const float signalStabilityThreshold = 0.25; // Higher variance tolerance for bursts
-const int patternConsistency = 3;            // Pattern must be consistent across readings
+class AnalogSampleSource : public SampleSource {
+public:
+  bool read(int* values, int count) {
+    for (int s = 0; s < count; s++) values[s] = analogRead(sensorPins[s]);
+    return true;
+  }
+};
 
-// 🔍 BURST SIGNATURE DETECTION (Real-world pipeline burst frequencies)
-const float burstFreqMin = 20.0;        // Min frequency for burst (20-60 Hz typical)
-const float burstFreqMax = 80.0;        // Max frequency for burst (60-120 Hz possible)
-const float amplitudeConsistency = 0.4; // Amplitude variation tolerance for bursts
-const float burstAmplitudeSpike = 2.5;  // Burst causes 2.5x amplitude spike
+// One HTTPClient kept across requests so the TCP connection is reused
+class HttpTransport : public Transport {
+public:
+  explicit HttpTransport(const char* url) : url(url) {
+    http.setReuse(true);
+    http.setTimeout(1500);
+  }
+  bool connected() { return WiFi.status() == WL_CONNECTED; }
+  int post(const uint8_t* data, size_t size) {
+    http.begin(url);
+    http.addHeader("Content-Type", "application/octet-stream");
+    // Lets the backend place spooled batches at the time they were measured
+    http.addHeader("X-Device-Ms", String(millis()));
+    int status = http.POST((uint8_t*)data, size);  // HTTPClient takes a non-const buffer
+    http.end();  // keeps the connection open with setReuse(true)
+    return status;
+  }
 
-// Enhanced sensor data structure
-struct PrecisionSensor {
-  int readings[signalWindow];
-  int noiseBaseline[noiseWindow];
-  float amplitudeHistory[15];
-  int readIndex, noiseIndex, ampIndex;
-  int total, noiseTotal, count, noiseCount;
-  
-  // Advanced filtering
-  int consecutiveLeak, consecutiveBurst, consecutiveCatastrophic;
-  float signalVariance, amplitudeVariance;
-  unsigned long leakStartTime, lastHighVibration;
-  bool inLeakState, inBurstState, inCatastrophicState;
-  
-  // Pattern detection
-  int peakCount, valleyCount;
-  float averagePeakInterval;
-  int lastPeakTime, patternScore;
-  bool signalStable;
-  
-  // Quality metrics
-  float signalQuality, noiseRatio;
-  int falsePositiveCount;
-  
-  // Burst-specific metrics
-  float burstAmplitude, burstFrequency;
-  int burstDuration, burstIntensity;
+private:
+  const char* url;
+  HTTPClient http;
 };
 
-PrecisionSensor sensors[numSensors];
+// Calibration record in NVS; Preferences writes a blob atomically
+class NvsCalibrationStore : public CalibrationStore {
+public:
+  bool load(uint8_t* data, size_t capacity, size_t* size) {
+    if (!prefs.begin("leakdsp", true)) return false;
+    size_t length = prefs.getBytesLength("calibration");
+    *size = length > 0 && length <= capacity ? prefs.getBytes("calibration", data, length) : 0;
+    prefs.end();
+    return *size > 0;
+  }
+  bool save(const uint8_t* data, size_t size) {
+    if (!prefs.begin("leakdsp", false)) return false;
+    size_t written = prefs.putBytes("calibration", data, size);
+    prefs.end();
+    return written == size;
+  }
 
-// Multi-sensor correlation
-struct SensorCorrelation {
-  float correlation_12, correlation_23, correlation_13;
-  float timeDelay_12, timeDelay_23, timeDelay_13;
-  bool sensorsAgree;
-  int agreementScore;
+private:
+  Preferences prefs;
 };
 
-SensorCorrelation sensorCorr;
+ArduinoClock boardClock;
+AnalogSampleSource piezoSource;
+LeakDetector detector(boardClock);
 
-// Leak detection state
-struct LeakDetectionState {
-  bool confirmed;
-  String location;
-  int primarySensor;
-  float confidence;
-  unsigned long detectionTime;
-  int stabilityScore;
-  bool environmentalNoise;
-  String burstType;  // "leak", "burst", "catastrophic"
-  float burstIntensity;
-};
+// Warm start: baselines checkpointed to NVS and restored after a reset
+NvsCalibrationStore calibrationStore;
+CalibrationCheckpoint<LeakDetector> calibrationCheckpoint(calibrationStore);
+
+// Acquisition, analysis and network run as separate tasks connected by
+// lock-free rings, so a slow HTTP POST never leaves gaps in the samples.
+SampleRing sampleRing;
+TelemetryRing telemetryRing;
+WaveformUpload waveformUpload;  // raw samples around the last detection event
+AcquisitionStage acquisition(piezoSource, sampleRing);
+AnalysisStage analysis(detector, sampleRing, telemetryRing, &waveformUpload);
 
-LeakDetectionState leakState;
+// Uplink: window summaries reported by exception, into a bounded queue drained
+// by its own task and spooled to flash while offline
+ExceptionReporter reporter;  // ReportTolerance sets the deltas and heartbeat
+HttpTransport uplink(serverName);
+HttpTransport captureUplink(captureUrl);
+const unsigned long captureRetryMs = 5000;
+FileSpool telemetrySpool("/littlefs/telemetry.spool", 256 * 1024);
+Transmitter transmitter(uplink, telemetrySpool, boardClock);
 
 // LED and control pins
 const int greenLEDPin = 12;
@@ -107,187 +118,69 @@ const int buzzerPin = 27;
 unsigned long previousMillis = 0;
 const long burstBlinkInterval = 100;  // Faster blinking for burst
 bool redLEDBlinkState = false;
-unsigned long lastHttpSend = 0;
-const long httpInterval = 100; // Faster updates for burst monitoring
+unsigned long lastSerialLog = 0;
+const long serialLogInterval = 100;
 
-// 🧮 ADVANCED CALCULATION FUNCTIONS
-
-float calculateVariance(int* array, int size, int mean) {
-  if (size < 2) return 0;
-  float variance = 0;
-  for (int i = 0; i < size; i++) {
-    variance += pow(array[i] - mean, 2);
+// ⏱️ Fixed-rate acquisition task (core 1, above loop() priority)
+void acquisitionTask(void* parameter) {
+  const TickType_t period = pdMS_TO_TICKS(1000 / sampleRateHz);
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    acquisition.sample(millis(), micros());
+    vTaskDelayUntil(&lastWake, period);
   }
-  return variance / size;
 }
 
-float calculateCorrelation(int sensor1, int sensor2) {
-  if (sensors[sensor1].count < signalWindow || sensors[sensor2].count < signalWindow) return 0;
-  
-  float mean1 = sensors[sensor1].total / sensors[sensor1].count;
-  float mean2 = sensors[sensor2].total / sensors[sensor2].count;
-  
-  float numerator = 0, denom1 = 0, denom2 = 0;
-  
-  for (int i = 0; i < signalWindow; i++) {
-    float x = sensors[sensor1].readings[i] - mean1;
-    float y = sensors[sensor2].readings[i] - mean2;
-    numerator += x * y;
-    denom1 += x * x;
-    denom2 += y * y;
-  }
-  
-  float denominator = sqrt(denom1 * denom2);
-  return (denominator > 0) ? numerator / denominator : 0;
-}
-
-bool detectBurstPattern(int sensorIndex) {
-  PrecisionSensor* s = &sensors[sensorIndex];
-  
-  // 1. Check signal stability for burst conditions
-  float avgValue = s->total / (s->count > 0 ? s->count : 1);
-  s->signalVariance = calculateVariance(s->readings, s->count, avgValue);
-  float stabilityRatio = s->signalVariance / max(1.0f, avgValue);
-  s->signalStable = (stabilityRatio < signalStabilityThreshold);
-  
-  // 2. Amplitude consistency check for burst signature
-  if (avgValue > leakThreshold) {
-    s->amplitudeHistory[s->ampIndex] = avgValue;
-    s->ampIndex = (s->ampIndex + 1) % 15;
-    
-    if (s->ampIndex == 0) { // Calculate amplitude variance every 15 readings
-      float ampMean = 0;
-      for (int i = 0; i < 15; i++) ampMean += s->amplitudeHistory[i];
-      ampMean /= 15;
-      
-      s->amplitudeVariance = 0;
-      for (int i = 0; i < 15; i++) {
-        s->amplitudeVariance += pow(s->amplitudeHistory[i] - ampMean, 2);
-      }
-      s->amplitudeVariance /= 15;
-      
-      // Calculate burst amplitude
-      s->burstAmplitude = ampMean;
+// 📦 Network task (core 0): reports window summaries by exception
+// (dsp/report_by_exception.h) and packs them into binary batches
+// (dsp/telemetry_codec.h), sent within a second or at once on a state change.
+void networkTask(void* parameter) {
+  TelemetrySnapshot snapshot;
+  TelemetryBatch batch;
+  for (;;) {
+    if (telemetryRing.pop(snapshot)) {
+      TelemetryRecord record = telemetryRecord(snapshot);
+      if (reporter.offer(record) != ReportSuppressed) batch.add(record);
+    } else {
+      vTaskDelay(pdMS_TO_TICKS(5));
     }
+    if (!batch.ready(millis())) continue;
+    transmitter.enqueue(batch);
+    batch.clear();
   }
-  
-  // 3. Burst pattern consistency scoring
-  bool patternConsistent = (s->signalStable && s->amplitudeVariance < (avgValue * amplitudeConsistency));
-  
-  return patternConsistent;
 }
 
-bool isEnvironmentalNoise(int sensorIndex) {
-  PrecisionSensor* s = &sensors[sensorIndex];
-  unsigned long currentTime = millis();
-  
-  // 1. Recent high vibration check (extended cooldown for urban environment)
-  if (currentTime - s->lastHighVibration < vibrationCooldown) {
-    return true;
-  }
-  
-  // 2. Signal quality check
-  float avgValue = s->total / (s->count > 0 ? s->count : 1);
-  float noiseAvg = s->noiseTotal / (s->noiseCount > 0 ? s->noiseCount : 1);
-  s->noiseRatio = avgValue / max(1.0f, noiseAvg);
-  
-  // 3. Sudden spike detection (environmental noise signature)
-  bool suddenSpike = false;
-  if (s->count >= 3) {
-    int recent = s->readings[(s->readIndex - 1 + signalWindow) % signalWindow];
-    int previous = s->readings[(s->readIndex - 2 + signalWindow) % signalWindow];
-    float spikeRatio = abs(recent - previous) / max(1.0f, (float)previous);
-    
-    if (spikeRatio > 3.0) { // 300% sudden change indicates environmental noise
-      s->lastHighVibration = currentTime;
-      suddenSpike = true;
+// 📡 Transmit task (core 0, next to the WiFi stack): sends, retries with
+// backoff, spools while offline and replays in order after reconnect.
+// Waveform captures go out between batches; the analysis task keeps the
+// slot untouched until it is released here.
+void transmitTask(void* parameter) {
+  unsigned long lastCaptureAttempt = 0;
+  bool captureAttempted = false;
+  for (;;) {
+    transmitter.poll();
+    if (waveformUpload.ready.load(std::memory_order_acquire) && captureUplink.connected() &&
+        (!captureAttempted || millis() - lastCaptureAttempt >= captureRetryMs)) {
+      lastCaptureAttempt = millis();
+      captureAttempted = true;
+      int status = captureUplink.post(waveformUpload.bytes, waveformUpload.size);
+      // 🎯 RELEASE THE SLOT ONCE THE SERVER HAS ANSWERED; A 4XX WILL NOT IMPROVE ON RETRY
+      if (status >= 200 && status < 500) {
+        waveformUpload.ready.store(false, std::memory_order_release);
+        captureAttempted = false;
+      }
     }
-  }
-  
-  return suddenSpike || (s->noiseRatio > 15.0); // Signal 15x above baseline = likely noise
-}
-
-void updateSensorCorrelations() {
-  sensorCorr.correlation_12 = calculateCorrelation(0, 1);
-  sensorCorr.correlation_23 = calculateCorrelation(1, 2);
-  sensorCorr.correlation_13 = calculateCorrelation(0, 2);
-  
-  // Calculate agreement score
-  float avgCorrelation = (abs(sensorCorr.correlation_12) + abs(sensorCorr.correlation_23) + abs(sensorCorr.correlation_13)) / 3.0;
-  sensorCorr.sensorsAgree = (avgCorrelation > sensorAgreementThreshold);
-  sensorCorr.agreementScore = (int)(avgCorrelation * 100);
-}
-
-String determineLeakLocation() {
-  // Find strongest correlations to determine location
-  float maxCorr = max(abs(sensorCorr.correlation_12), max(abs(sensorCorr.correlation_23), abs(sensorCorr.correlation_13)));
-  
-  if (maxCorr < 0.3) return "Isolated sensor activity - possible false positive";
-  
-  if (abs(sensorCorr.correlation_12) == maxCorr) {
-    return "Between Sensor 1 and Sensor 2 - Main Pipeline Section";
-  } else if (abs(sensorCorr.correlation_23) == maxCorr) {
-    return "Between Sensor 2 and Sensor 3 - Secondary Pipeline Section";
-  } else {
-    return "Near Sensor 1 or Sensor 3 - Pipeline Junction Area";
-  }
-}
-
-String determineBurstType(float avgAmplitude) {
-  if (avgAmplitude >= catastrophicBurstThreshold) {
-    return "CATASTROPHIC BURST";
-  } else if (avgAmplitude >= burstThreshold) {
-    return "PIPELINE BURST";
-  } else if (avgAmplitude >= leakThreshold) {
-    return "PIPELINE LEAK";
-  } else {
-    return "NORMAL FLOW";
+    vTaskDelay(pdMS_TO_TICKS(5));
   }
 }
 
 void setup() {
   Serial.begin(115200);
+  unsigned long bootMillis = millis();
+  // Associate in the background; the transmitter spools until WiFi is up
   WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(1000);
-    Serial.print(".");
-  }
-  Serial.println("\n✅ Connected to WiFi");
   
-  // Initialize precision sensor structures
-  for (int s = 0; s < numSensors; s++) {
-    for (int i = 0; i < signalWindow; i++) sensors[s].readings[i] = 0;
-    for (int i = 0; i < noiseWindow; i++) sensors[s].noiseBaseline[i] = 0;
-    for (int i = 0; i < 15; i++) sensors[s].amplitudeHistory[i] = 0;
-    
-    sensors[s].readIndex = 0;
-    sensors[s].noiseIndex = 0;
-    sensors[s].ampIndex = 0;
-    sensors[s].total = 0;
-    sensors[s].noiseTotal = 0;
-    sensors[s].count = 0;
-    sensors[s].noiseCount = 0;
-    sensors[s].consecutiveLeak = 0;
-    sensors[s].consecutiveBurst = 0;
-    sensors[s].consecutiveCatastrophic = 0;
-    sensors[s].leakStartTime = 0;
-    sensors[s].lastHighVibration = 0;
-    sensors[s].inLeakState = false;
-    sensors[s].inBurstState = false;
-    sensors[s].inCatastrophicState = false;
-    sensors[s].signalStable = false;
-    sensors[s].falsePositiveCount = 0;
-  }
-  
-  // Initialize leak state
-  leakState.confirmed = false;
-  leakState.location = "No leak detected";
-  leakState.primarySensor = -1;
-  leakState.confidence = 0;
-  leakState.stabilityScore = 0;
-  leakState.environmentalNoise = false;
-  leakState.burstType = "NORMAL";
-  leakState.burstIntensity = 0;
+  detector.reset();
   
   // Setup pins
   pinMode(greenLEDPin, OUTPUT);
@@ -297,36 +190,41 @@ void setup() {
   digitalWrite(redLEDPin, LOW);
   digitalWrite(buzzerPin, LOW);
   
-  // LED test
-  digitalWrite(greenLEDPin, HIGH);
-  digitalWrite(redLEDPin, HIGH);
-  delay(2000);
-  digitalWrite(greenLEDPin, LOW);
-  digitalWrite(redLEDPin, LOW);
-  
-  // Extended calibration for municipal environment
-  Serial.println("🔄 MUNICIPAL PIPELINE CALIBRATION (15 seconds)...");
-  for (int i = 0; i < 600; i++) { // 15 seconds
+  CalibrationSnapshot restored;
+  if (calibrationCheckpoint.restore(detector, &restored)) {
+    // ♻️ Warm start: detect at once, the baselines keep refining while running
+    Serial.println("♻️ CALIBRATION RESTORED FROM NVS");
     for (int s = 0; s < numSensors; s++) {
-      int sensorValue = analogRead(sensorPins[s]);
-      sensors[s].noiseBaseline[i % noiseWindow] = sensorValue;
-      if (i < noiseWindow) sensors[s].noiseCount++;
+      Serial.printf("Sensor %d baseline: %.1f, thresholds %d/%d/%d\n", s + 1, restored.noiseMeanQ4[s] / 16.0f,
+                    restored.thresholds[s].leak, restored.thresholds[s].burst, restored.thresholds[s].catastrophic);
     }
-    delay(25);
-  }
-  
-  // Calculate noise baselines
-  for (int s = 0; s < numSensors; s++) {
-    for (int i = 0; i < sensors[s].noiseCount; i++) {
-      sensors[s].noiseTotal += sensors[s].noiseBaseline[i];
+  } else {
+    // LED test
+    digitalWrite(greenLEDPin, HIGH);
+    digitalWrite(redLEDPin, HIGH);
+    delay(2000);
+    digitalWrite(greenLEDPin, LOW);
+    digitalWrite(redLEDPin, LOW);
+    
+    // Extended calibration for municipal environment (first boot only)
+    Serial.println("🔄 MUNICIPAL PIPELINE CALIBRATION (15 seconds)...");
+    for (int i = 0; i < calibrationSamples; i++) {
+      int samples[numSensors];
+      piezoSource.read(samples, numSensors);
+      detector.addCalibrationSample(samples);
+      delay(calibrationIntervalMs);
+    }
+    
+    for (int s = 0; s < numSensors; s++) {
+      Serial.print("Sensor ");
+      Serial.print(s+1);
+      Serial.print(" baseline: ");
+      Serial.println(detector.noiseBaseline(s));
     }
-    Serial.print("Sensor ");
-    Serial.print(s+1);
-    Serial.print(" baseline: ");
-    Serial.println(sensors[s].noiseTotal / sensors[s].noiseCount);
+    calibrationCheckpoint.save(detector);
+    Serial.println("✅ MUNICIPAL PIPELINE CALIBRATION COMPLETE!");
   }
   
-  Serial.println("✅ MUNICIPAL PIPELINE CALIBRATION COMPLETE!");
   Serial.println("🏗️ REAL-WORLD THRESHOLDS:");
   Serial.print("   Normal Flow: < ");
   Serial.println(normalFlowThreshold);
@@ -336,191 +234,34 @@ void setup() {
   Serial.println(burstThreshold);
   Serial.print("   Catastrophic: > ");
   Serial.println(catastrophicBurstThreshold);
+  
+  if (!LittleFS.begin(true) || !telemetrySpool.open()) {
+    Serial.println("⚠️ Telemetry spool unavailable - offline data will be dropped");
+  }
+  
+  Serial.print("⏱️ Detecting ");
+  Serial.print(millis() - bootMillis);
+  Serial.println(" ms after boot");
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", 4096, NULL, 3, NULL, 1);
+  xTaskCreatePinnedToCore(networkTask, "network", 4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(transmitTask, "transmit", 8192, NULL, 1, NULL, 0);
 }
 
 void loop() {
   unsigned long currentMillis = millis();
   
-  // Read all sensors with precision processing
-  bool anyLeakDetected = false;
-  bool anyBurstDetected = false;
-  bool anyCatastrophicDetected = false;
-  int strongestSensor = -1;
-  int strongestReading = 0;
-  int activeLeakSensors = 0;
-  float totalBurstIntensity = 0;
-  
-  for (int s = 0; s < numSensors; s++) {
-    int sensorValue = analogRead(sensorPins[s]);
-    
-    // Update moving average
-    sensors[s].total -= sensors[s].readings[sensors[s].readIndex];
-    sensors[s].readings[sensors[s].readIndex] = sensorValue;
-    sensors[s].total += sensors[s].readings[sensors[s].readIndex];
-    sensors[s].readIndex = (sensors[s].readIndex + 1) % signalWindow;
-    if (sensors[s].count < signalWindow) sensors[s].count++;
-    
-    int avgValue = sensors[s].total / sensors[s].count;
-    
-    // Update noise baseline (only during quiet periods)
-    if (avgValue < (sensors[s].noiseTotal / max(1, sensors[s].noiseCount)) + 30) {
-      sensors[s].noiseTotal -= sensors[s].noiseBaseline[sensors[s].noiseIndex];
-      sensors[s].noiseBaseline[sensors[s].noiseIndex] = sensorValue;
-      sensors[s].noiseTotal += sensors[s].noiseBaseline[sensors[s].noiseIndex];
-      sensors[s].noiseIndex = (sensors[s].noiseIndex + 1) % noiseWindow;
-      if (sensors[s].noiseCount < noiseWindow) sensors[s].noiseCount++;
-    }
-    
-    // Calculate adaptive thresholds for municipal environment
-    int noiseAvg = sensors[s].noiseTotal / max(1, sensors[s].noiseCount);
-    float noiseStdDev = sqrt(calculateVariance(sensors[s].noiseBaseline, sensors[s].noiseCount, noiseAvg));
-    int adaptiveLeakThreshold = max(leakThreshold, (int)(noiseAvg + noiseStdDev * adaptiveMultiplier));
-    int adaptiveBurstThreshold = max(burstThreshold, (int)(noiseAvg + noiseStdDev * 4.0));
-    int adaptiveCatastrophicThreshold = max(catastrophicBurstThreshold, (int)(noiseAvg + noiseStdDev * 6.0));
-    
-    // 🎯 PRECISION FILTERING FOR MUNICIPAL PIPELINES
-    bool isNoise = isEnvironmentalNoise(s);
-    bool hasPattern = detectBurstPattern(s);
-    bool aboveLeakThreshold = (avgValue > adaptiveLeakThreshold);
-    bool aboveBurstThreshold = (avgValue > adaptiveBurstThreshold);
-    bool aboveCatastrophicThreshold = (avgValue > adaptiveCatastrophicThreshold);
-    
-    // Combined precision detection for municipal conditions
-    bool precisionLeak = aboveLeakThreshold && !isNoise && hasPattern;
-    bool precisionBurst = aboveBurstThreshold && !isNoise && hasPattern;
-    bool precisionCatastrophic = aboveCatastrophicThreshold && !isNoise && hasPattern;
-    
-    // Consecutive reading logic with burst-specific requirements
-    if (precisionCatastrophic) {
-      sensors[s].consecutiveCatastrophic++;
-      sensors[s].consecutiveBurst++;
-      sensors[s].consecutiveLeak++;
-    } else if (precisionBurst) {
-      sensors[s].consecutiveBurst++;
-      sensors[s].consecutiveLeak++;
-      sensors[s].consecutiveCatastrophic = 0;
-    } else if (precisionLeak) {
-      sensors[s].consecutiveLeak++;
-      sensors[s].consecutiveBurst = 0;
-      sensors[s].consecutiveCatastrophic = 0;
-    } else {
-      sensors[s].consecutiveLeak = max(0, sensors[s].consecutiveLeak - 1);
-      sensors[s].consecutiveBurst = 0;
-      sensors[s].consecutiveCatastrophic = 0;
-    }
-    
-    // State management with burst-specific duration validation
-    bool sensorLeakDetected = (sensors[s].consecutiveLeak >= requiredConsecutive);
-    bool sensorBurstDetected = (sensors[s].consecutiveBurst >= requiredConsecutive);
-    bool sensorCatastrophicDetected = (sensors[s].consecutiveCatastrophic >= (requiredConsecutive - 2));
-    
-    if (sensorCatastrophicDetected) {
-      if (!sensors[s].inCatastrophicState) {
-        sensors[s].leakStartTime = currentMillis;
-        sensors[s].inCatastrophicState = true;
-      }
-      if (currentMillis - sensors[s].leakStartTime >= burstResponseTime) {
-        anyCatastrophicDetected = true;
-        anyBurstDetected = true;
-        anyLeakDetected = true;
-        activeLeakSensors++;
-        totalBurstIntensity += avgValue;
-      }
-    } else if (sensorBurstDetected) {
-      if (!sensors[s].inBurstState) {
-        sensors[s].leakStartTime = currentMillis;
-        sensors[s].inBurstState = true;
-      }
-      if (currentMillis - sensors[s].leakStartTime >= burstResponseTime) {
-        anyBurstDetected = true;
-        anyLeakDetected = true;
-        activeLeakSensors++;
-        totalBurstIntensity += avgValue;
-      }
-      sensors[s].inCatastrophicState = false;
-    } else if (sensorLeakDetected) {
-      if (!sensors[s].inLeakState) {
-        sensors[s].leakStartTime = currentMillis;
-        sensors[s].inLeakState = true;
-      }
-      if (currentMillis - sensors[s].leakStartTime >= minLeakDuration) {
-        anyLeakDetected = true;
-        activeLeakSensors++;
-        totalBurstIntensity += avgValue;
-      }
-      sensors[s].inBurstState = false;
-      sensors[s].inCatastrophicState = false;
-    } else {
-      sensors[s].inLeakState = false;
-      sensors[s].inBurstState = false;
-      sensors[s].inCatastrophicState = false;
-    }
-    
-    if (avgValue > strongestReading) {
-      strongestReading = avgValue;
-      strongestSensor = s;
-    }
-  }
-  
-  // 🎯 MULTI-SENSOR PRECISION VALIDATION FOR MUNICIPAL PIPELINES
-  updateSensorCorrelations();
-  
-  // Final leak confirmation with municipal-specific validation
-  bool finalLeakConfirmed = false;
-  bool finalBurstConfirmed = false;
-  bool finalCatastrophicConfirmed = false;
-  
-  if (anyLeakDetected || anyBurstDetected || anyCatastrophicDetected) {
-    // Requirement 1: Multiple sensors must agree (for municipal reliability)
-    bool multiSensorAgreement = (activeLeakSensors >= 2) || sensorCorr.sensorsAgree;
-    
-    // Requirement 2: Signal stability across sensors
-    bool signalStability = true;
-    for (int s = 0; s < numSensors; s++) {
-      if (sensors[s].inLeakState && !sensors[s].signalStable) {
-        signalStability = false;
-        break;
-      }
-    }
-    
-    // Requirement 3: Environmental noise check for urban environment
-    bool noEnvironmentalNoise = true;
-    for (int s = 0; s < numSensors; s++) {
-      if (isEnvironmentalNoise(s)) {
-        noEnvironmentalNoise = false;
-        leakState.environmentalNoise = true;
-        break;
-      }
-    }
-    
-    // Final decision with municipal precision filters
-    finalLeakConfirmed = anyLeakDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
-    finalBurstConfirmed = anyBurstDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
-    finalCatastrophicConfirmed = anyCatastrophicDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
-    
-    if (finalLeakConfirmed || finalBurstConfirmed || finalCatastrophicConfirmed) {
-      leakState.confirmed = true;
-      leakState.location = determineLeakLocation();
-      leakState.primarySensor = strongestSensor;
-      leakState.confidence = min(100.0f, (float)(sensorCorr.agreementScore + (signalStability ? 25 : 0)));
-      leakState.detectionTime = currentMillis;
-      leakState.stabilityScore = signalStability ? 100 : 50;
-      leakState.burstIntensity = totalBurstIntensity / max(1, activeLeakSensors);
-      
-      if (finalCatastrophicConfirmed) {
-        leakState.burstType = "CATASTROPHIC BURST";
-      } else if (finalBurstConfirmed) {
-        leakState.burstType = "PIPELINE BURST";
-      } else {
-        leakState.burstType = "PIPELINE LEAK";
-      }
-    }
-  } else {
-    leakState.confirmed = false;
-    leakState.environmentalNoise = false;
-    leakState.burstType = "NORMAL FLOW";
-    leakState.burstIntensity = 0;
+  // Run every queued frame through the precision detection pipeline
+  if (analysis.drain(sampleRingSize) == 0) {
+    delay(1);
+    return;
   }
+  calibrationCheckpoint.poll(detector, currentMillis);
+  const Decision& decision = detector.decision();
+  const LeakDetectionState& leakState = detector.leakState();
+  const SensorCorrelation& sensorCorr = detector.correlation();
+  bool finalLeakConfirmed = decision.leakConfirmed;
+  bool finalBurstConfirmed = decision.burstConfirmed;
+  bool finalCatastrophicConfirmed = decision.catastrophicConfirmed;
   
   // LED control with municipal burst confirmation
   if (finalCatastrophicConfirmed) {
@@ -552,12 +293,14 @@ void loop() {
   }
   
   // Enhanced debugging output for municipal pipeline monitoring
+  if (currentMillis - lastSerialLog < serialLogInterval) return;
+  lastSerialLog = currentMillis;
   Serial.print("🏗️ MUNICIPAL PIPELINE: S1:");
-  Serial.print(sensors[0].total / max(1, sensors[0].count));
+  Serial.print(detector.average(0));
   Serial.print(" S2:");
-  Serial.print(sensors[1].total / max(1, sensors[1].count));
+  Serial.print(detector.average(1));
   Serial.print(" S3:");
-  Serial.print(sensors[2].total / max(1, sensors[2].count));
+  Serial.print(detector.average(2));
   Serial.print(" | Corr:");
   Serial.print(sensorCorr.agreementScore);
   Serial.print("% | Status:");
@@ -567,38 +310,21 @@ void loop() {
   Serial.print(" | Conf:");
   Serial.print(leakState.confidence);
   Serial.print("% | Intensity:");
-  Serial.print(leakState.burstIntensity);
+  Serial.print(leakState.burstIntensity10 / 10.0f);
+  Serial.print(" | Dropped:");
+  Serial.print(acquisition.dropped());
+  TransmitStats tx = transmitter.stats();
+  Serial.print(" | TxQueue:");
+  Serial.print(tx.queueDepth);
+  Serial.print(" Spool:");
+  Serial.print(tx.spoolDepth);
+  Serial.print(" Reported:");
+  Serial.print(reporter.sent());
+  Serial.print(" TxDropped:");
+  Serial.print(tx.dropped);
+  Serial.print(" TxLatency:");
+  Serial.print(tx.lastLatencyMs);
+  Serial.print("ms Captures:");
+  Serial.print(analysis.captures());
   Serial.println();
-  
-  // HTTP transmission with municipal pipeline data
-  if (WiFi.status() == WL_CONNECTED && (currentMillis - lastHttpSend >= httpInterval)) {
-    lastHttpSend = currentMillis;
-    
-    HTTPClient http;
-    http.setTimeout(1500);
-    http.begin(serverName);
-    http.addHeader("Content-Type", "application/json");
-    
-    String jsonData = "{"
-      "\"sensor1\": " + String(sensors[0].total / max(1, sensors[0].count)) + ","
-      "\"sensor2\": " + String(sensors[1].total / max(1, sensors[1].count)) + ","
-      "\"sensor3\": " + String(sensors[2].total / max(1, sensors[2].count)) + ","
-      "\"leak_confirmed\": " + String(finalLeakConfirmed ? 1 : 0) + ","
-      "\"burst_confirmed\": " + String(finalBurstConfirmed || finalCatastrophicConfirmed ? 1 : 0) + ","
-      "\"leak_location\": \"" + leakState.location + "\","
-      "\"confidence\": " + String(leakState.confidence) + ","
-      "\"correlation_score\": " + String(sensorCorr.agreementScore) + ","
-      "\"stability_score\": " + String(leakState.stabilityScore) + ","
-      "\"environmental_noise\": " + String(leakState.environmentalNoise ? 1 : 0) + ","
-      "\"active_sensors\": " + String(activeLeakSensors) + ","
-      "\"burst_type\": \"" + leakState.burstType + "\","
-      "\"burst_intensity\": " + String(leakState.burstIntensity) + ","
-      "\"timestamp\": " + String(currentMillis) +
-    "}";
-    
-    http.POST(jsonData);
-    http.end();
-  }
-  
-  delay(15); // Faster sampling for municipal burst detection
-}
\ No newline at end of file
+}
@@ -1,9 +1,32 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <LittleFS.h>
+
+#include <atomic>
+
+#include "dsp/command_codec.h"
+#include "dsp/file_spool.h"
+#include "dsp/report_by_exception.h"
+#include "dsp/rolling_stats.h"
+#include "dsp/telemetry_codec.h"
+#include "dsp/transmit.h"
+
+using leakdsp::Clock;
+using leakdsp::Command;
+using leakdsp::CommandParser;
+using leakdsp::ExceptionReporter;
+using leakdsp::FileSpool;
+using leakdsp::RollingWindow;
+using leakdsp::TelemetryBatch;
+using leakdsp::TelemetryRecord;
+using leakdsp::Transmitter;
+using leakdsp::Transport;
 
 const char* ssid = "realme 8 5G";
 const char* password = "2yg4ysmr";
-const char* serverName = "http://192.168.242.192:5000/api/data";
+const char* serverName = "http://192.168.242.192:5000/api/data/batch";
+const char* commandUrl = "http://192.168.242.192:5000/api/commands";
+const char* deviceId = "node-01";  // unique per device: [A-Za-z0-9_.-], up to 32 chars
 
 // Sensor pins
 const int piezoPin1 = 35;
@@ -32,19 +55,60 @@ unsigned long previousMillis = 0;
 const long burstBlinkInterval = 200;  // Blink every 200ms for burst
 bool redLEDBlinkState = false;
 unsigned long lastHttpSend = 0;
-const long httpInterval = 100; // Send data every 100ms
+const long httpInterval = 100; // Summarise every 100ms, report by exception in batches
+ExceptionReporter telemetryReporter;
+TelemetryBatch telemetryBatch;
+
+class ArduinoClock : public Clock {
+public:
+  uint32_t nowMs() { return millis(); }
+};
+
+// One HTTPClient kept across requests so the TCP connection is reused
+class HttpTransport : public Transport {
+public:
+  explicit HttpTransport(const char* url) : url(url) {
+    http.setReuse(true);
+    http.setTimeout(1500);
+  }
+  bool connected() { return WiFi.status() == WL_CONNECTED; }
+  int post(const uint8_t* data, size_t size) {
+    http.begin(url);
+    http.addHeader("Content-Type", "application/octet-stream");
+    // Lets the backend place spooled batches at the time they were measured
+    http.addHeader("X-Device-Ms", String(millis()));
+    int status = http.POST((uint8_t*)data, size);  // HTTPClient takes a non-const buffer
+    http.end();  // keeps the connection open with setReuse(true)
+    return status;
+  }
+
+private:
+  const char* url;
+  HTTPClient http;
+};
 
-// Dismiss state variables
-bool burstDismissed = false;
-unsigned long lastDismissCheck = 0;
-const long dismissCheckInterval = 1000; // Check dismiss state every 1 second
+// Batches leave loop() through a queue drained by transmitTask, and are
+// spooled to flash while WiFi is down (dsp/transmit.h)
+ArduinoClock boardClock;
+HttpTransport uplink(serverName);
+FileSpool telemetrySpool("/littlefs/telemetry.spool", 256 * 1024);
+Transmitter transmitter(uplink, telemetrySpool, boardClock);
+
+// Dismiss state, written by commandTask and read by loop()
+std::atomic<bool> burstDismissed(false);
+int lastBurstLevel = 0;  // 0 none, 1 burst, 2 catastrophic; a rise re-arms the alarm
+
+// Command channel (long-poll, see backend/commands.js)
+const int commandWaitMs = 25000;         // server holds the poll this long
+const uint32_t commandRetryMaxMs = 30000;
+uint32_t lastCommandSequence = 0;        // acknowledged to the server as `after`
+CommandParser commandParser;
 
 // Signal processing structures
 struct SignalProcessor {
   int rawValue;
   int filteredValue;
-  int movingAverage[movingAverageSize];
-  int averageIndex;
+  RollingWindow<movingAverageSize> movingAverage;
   int environmentalNoise;
 };
 
@@ -62,8 +126,9 @@ struct DetectionState {
   bool leakDetected;
   bool burstDetected;
   bool catastrophicDetected;
-  String burstType;
-  String location;
+  const char* burstType;
+  leakdsp::LocationKind location;
+  int locationA, locationB;  // sensors named by the location, 0-based
   int activeSensors;
   float confidence;
   float burstIntensity;
@@ -77,76 +142,96 @@ DetectionState detectionState;
 void initSignalProcessor(SignalProcessor* processor) {
   processor->rawValue = 0;
   processor->filteredValue = 0;
-  processor->averageIndex = 0;
   processor->environmentalNoise = 0;
-  
-  for (int i = 0; i < movingAverageSize; i++) {
-    processor->movingAverage[i] = 0;
-  }
+  processor->movingAverage.fill(0);
 }
 
-// Calculate moving average
+// Calculate moving average (running sum, no rescan)
 int calculateMovingAverage(SignalProcessor* processor, int newValue) {
-  processor->movingAverage[processor->averageIndex] = newValue;
-  processor->averageIndex = (processor->averageIndex + 1) % movingAverageSize;
-  
-  int sum = 0;
-  for (int i = 0; i < movingAverageSize; i++) {
-    sum += processor->movingAverage[i];
-  }
-  return sum / movingAverageSize;
+  processor->movingAverage.push(newValue);
+  return processor->movingAverage.mean();
 }
 
 // Detect environmental noise
 bool detectEnvironmentalNoise(SignalProcessor* processor) {
-  int variance = 0;
-  int mean = 0;
-  
-  // Calculate mean
-  for (int i = 0; i < movingAverageSize; i++) {
-    mean += processor->movingAverage[i];
-  }
-  mean /= movingAverageSize;
-  
-  // Calculate variance
-  for (int i = 0; i < movingAverageSize; i++) {
-    int diff = processor->movingAverage[i] - mean;
-    variance += diff * diff;
-  }
-  variance /= movingAverageSize;
+  // Variance about the integer mean from the running sums
+  int mean = processor->movingAverage.mean();
+  int variance = (int)(processor->movingAverage.squaredDeviation(mean) / movingAverageSize);
   
   processor->environmentalNoise = variance;
   return variance > environmentalNoiseThreshold;
 }
 
-// Check dismiss state from backend
-void checkDismissState() {
-  if (WiFi.status() == WL_CONNECTED && (millis() - lastDismissCheck >= dismissCheckInterval)) {
-    lastDismissCheck = millis();
-    
-    HTTPClient http;
-    http.setTimeout(1500);
-    http.begin("http://192.168.242.192:5000/api/status");
-    
+// Applies one command from the backend
+void applyCommand(const Command& command, void* context) {
+  switch (command.type) {
+    case leakdsp::CommandDismissBurst:
+      if (!burstDismissed) Serial.println("🔘 BURST ALERT DISMISSED FROM DASHBOARD");
+      burstDismissed = true;
+      break;
+    case leakdsp::CommandClearDismiss:
+      burstDismissed = false;
+      break;
+    default:
+      break;  // ping, or a type this firmware doesn't know
+  }
+  lastCommandSequence = command.sequence;
+}
+
+// Holds one long-poll open to the backend on core 0, so a dashboard dismiss
+// arrives within one round trip and the backend sees one request per wait
+// period instead of a status query every second.
+void commandTask(void* parameter) {
+  static uint8_t frame[leakdsp::commandFrameMaxBytes];
+  static char url[160];
+  HTTPClient http;
+  http.setReuse(true);
+  http.setTimeout(commandWaitMs + 5000);
+  uint32_t retryMs = 1000;
+
+  for (;;) {
+    if (WiFi.status() != WL_CONNECTED) {
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+    snprintf(url, sizeof(url), "%s?device=%s&after=%lu&wait=%d", commandUrl, deviceId,
+             (unsigned long)lastCommandSequence, commandWaitMs);
+    http.begin(url);
     int httpResponseCode = http.GET();
-    if (httpResponseCode > 0) {
-      String payload = http.getString();
-      // Simple JSON parsing for burst_dismissed field
-      if (payload.indexOf("\"burst_dismissed\":true") != -1) {
-        if (!burstDismissed) {
-          burstDismissed = true;
-          Serial.println("🔘 BURST ALERT DISMISSED FROM DASHBOARD");
-        }
-      } else if (payload.indexOf("\"burst_dismissed\":false") != -1) {
-        burstDismissed = false;
+    bool ok = httpResponseCode == 204;
+    if (httpResponseCode == 200) {
+      int size = http.getSize();
+      WiFiClient* stream = http.getStreamPtr();
+      if (size > 0 && size <= leakdsp::commandFrameMaxBytes && stream &&
+          stream->readBytes(frame, size) == (size_t)size) {
+        commandParser.reset();
+        ok = commandParser.feed(frame, size, applyCommand, NULL) && commandParser.complete();
       }
     }
     http.end();
+
+    if (ok) {
+      retryMs = 1000;
+    } else {
+      Serial.print("Command poll error: ");
+      Serial.println(httpResponseCode);
+      vTaskDelay(pdMS_TO_TICKS(retryMs));
+      retryMs = retryMs * 2 > commandRetryMaxMs ? commandRetryMaxMs : retryMs * 2;
+    }
+  }
+}
+
+// Sends, retries with backoff, spools while offline and replays in order
+// after reconnect, on core 0 next to the WiFi stack
+void transmitTask(void* parameter) {
+  for (;;) {
+    transmitter.poll();
+    vTaskDelay(pdMS_TO_TICKS(5));
   }
 }
 
 // Determine location based on sensor values (highest values indicate leak/burst location)
-String determineLocation(SimpleSensor* sensors, int numSensors, int activeSensorCount) {
+void determineLocation(SimpleSensor* sensors, int numSensors, int activeSensorCount) {
   // Find the two sensors with highest values
   int max1 = 0, max2 = 0;
   int sensor1 = -1, sensor2 = -1;
@@ -164,35 +249,56 @@ String determineLocation(SimpleSensor* sensors, int numSensors, int activeSensor
     }
   }
   
-  // If only one sensor is active
+  detectionState.locationA = sensor1 >= 0 ? sensor1 : 0;
+  detectionState.locationB = sensor2 >= 0 ? sensor2 : 0;
+  
+  // If only one sensor is active ("Near Sensor N - ...")
   if (max2 < 20) {
-    if (sensor1 == 0) return "Near Sensor 1 - Main Pipeline Section";
-    if (sensor1 == 1) return "Near Sensor 2 - Secondary Pipeline Section";
-    if (sensor1 == 2) return "Near Sensor 3 - Pipeline Junction Area";
-    return "No activity detected";
+    detectionState.location = sensor1 >= 0 ? leakdsp::LocationNear : leakdsp::LocationNoActivity;
+    return;
   }
   
   // If two or more sensors are active, determine location between them
-  if (sensor1 == 0 && sensor2 == 1) {
-    return "Between Sensor 1 and Sensor 2 - Main Pipeline Section";
-  } else if (sensor1 == 1 && sensor2 == 2) {
-    return "Between Sensor 2 and Sensor 3 - Secondary Pipeline Section";
-  } else if (sensor1 == 0 && sensor2 == 2) {
-    return "Between Sensor 1 and Sensor 3 - Pipeline Junction Area";
-  } else if (sensor1 == 1 && sensor2 == 0) {
-    return "Between Sensor 2 and Sensor 1 - Main Pipeline Section";
-  } else if (sensor1 == 2 && sensor2 == 1) {
-    return "Between Sensor 3 and Sensor 2 - Secondary Pipeline Section";
-  } else if (sensor1 == 2 && sensor2 == 0) {
-    return "Between Sensor 3 and Sensor 1 - Pipeline Junction Area";
+  if (sensor1 >= 0 && sensor2 >= 0) {
+    detectionState.location = leakdsp::LocationBetween;
+    return;
   }
   
   // If all three sensors are active
   if (activeSensorCount >= 3) {
-    return "Multiple sensors - Pipeline section affected";
+    detectionState.location = leakdsp::LocationMultiple;
+    return;
   }
   
-  return "Unknown location";
+  detectionState.location = leakdsp::LocationUnknown;
+}
+
+// Summarise the current state for the backend; it is queued only when it
+// differs from the last report or the heartbeat is due
+void recordTelemetry(unsigned long currentMillis, int activeSensorCount) {
+  TelemetryRecord record;
+  record.timeMs = currentMillis;
+  for (int i = 0; i < numSensors; i++) {
+    record.values[i] = sensors[i].currentValue;
+    // No spectrum here: the loop samples far below the burst band
+    record.summary[i] = leakdsp::summarizeWindow(sensors[i].processor.movingAverage, 0);
+  }
+  record.flags = leakdsp::TelemetrySummary | (detectionState.leakDetected ? leakdsp::TelemetryLeak : 0) |
+                 (detectionState.burstDetected ? leakdsp::TelemetryBurst : 0) |
+                 (detectionState.catastrophicDetected ? leakdsp::TelemetryCatastrophic : 0) |
+                 (detectionState.environmentalNoise ? leakdsp::TelemetryEnvironmentalNoise : 0) |
+                 (burstDismissed ? leakdsp::TelemetryDismissed : 0);
+  record.burstType = leakdsp::burstTypeCode(detectionState.burstType);
+  record.locationKind = detectionState.location;
+  record.locationA = detectionState.locationA;
+  record.locationB = detectionState.locationB;
+  record.positionDm = 0;
+  record.confidence10 = (uint32_t)(detectionState.confidence * 10 + 0.5f);
+  record.correlationScore = (uint32_t)detectionState.correlationScore;
+  record.stabilityScore = 0;
+  record.activeSensors = activeSensorCount;
+  record.burstIntensity10 = (uint32_t)(detectionState.burstIntensity * 10 + 0.5f);
+  if (telemetryReporter.offer(record) != leakdsp::ReportSuppressed) telemetryBatch.add(record);
 }
 
 void setup() {
@@ -205,6 +311,11 @@ void setup() {
     Serial.print(".");
   }
   Serial.println("\n✅ Connected to WiFi");
+  if (!LittleFS.begin(true) || !telemetrySpool.open()) {
+    Serial.println("⚠️ Telemetry spool unavailable - offline data will be dropped");
+  }
+  xTaskCreatePinnedToCore(commandTask, "commands", 4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(transmitTask, "transmit", 8192, NULL, 1, NULL, 0);
   
   // Initialize sensors and signal processors
   for (int i = 0; i < numSensors; i++) {
@@ -219,7 +330,9 @@ void setup() {
   detectionState.burstDetected = false;
   detectionState.catastrophicDetected = false;
   detectionState.burstType = "NORMAL FLOW";
-  detectionState.location = "No activity detected";
+  detectionState.location = leakdsp::LocationNoActivity;
+  detectionState.locationA = 0;
+  detectionState.locationB = 0;
   detectionState.activeSensors = 0;
   detectionState.confidence = 0;
   detectionState.burstIntensity = 0;
@@ -249,9 +362,6 @@ void setup() {
 void loop() {
   unsigned long currentMillis = millis();
   
-  // Check dismiss state from backend
-  checkDismissState();
-  
   // Read and process all sensors
   int maxSensorValue = 0;
   int activeSensorCount = 0;
@@ -307,14 +417,12 @@ void loop() {
     detectionState.leakDetected = true;
     detectionState.burstType = "CATASTROPHIC BURST";
     detectionState.confidence = 95;
-    burstDismissed = false;  // Reset dismiss state for new burst
   } else if (maxSensorValue >= baseBurstThreshold) {
     detectionState.catastrophicDetected = false;
     detectionState.burstDetected = true;
     detectionState.leakDetected = true;
     detectionState.burstType = "PIPELINE BURST";
     detectionState.confidence = 85;
-    burstDismissed = false;  // Reset dismiss state for new burst
   } else if (maxSensorValue >= baseLeakThreshold) {
     detectionState.catastrophicDetected = false;
     detectionState.burstDetected = false;
@@ -329,7 +437,13 @@ void loop() {
     detectionState.confidence = 0;
   }
   
-  detectionState.location = determineLocation(sensors, numSensors, activeSensorCount);
+  // Reset dismiss state when a new burst starts or one escalates, not on
+  // every loop while it lasts (that would undo a dismiss straight away)
+  int burstLevel = detectionState.catastrophicDetected ? 2 : (detectionState.burstDetected ? 1 : 0);
+  if (burstLevel > lastBurstLevel) burstDismissed = false;
+  lastBurstLevel = burstLevel;
+  
+  determineLocation(sensors, numSensors, activeSensorCount);
   
   // LED control - SYNC WITH DETECTION AND DISMISS STATE
   if (detectionState.catastrophicDetected && !burstDismissed) {
@@ -398,40 +512,13 @@ void loop() {
   Serial.println();
   
   // Send data to backend
-  if (WiFi.status() == WL_CONNECTED && (currentMillis - lastHttpSend >= httpInterval)) {
+  if (currentMillis - lastHttpSend >= httpInterval) {
     lastHttpSend = currentMillis;
-    
-    HTTPClient http;
-    http.setTimeout(1500);
-    http.begin(serverName);
-    http.addHeader("Content-Type", "application/json");
-    
-    String jsonData = "{"
-      "\"sensor1\": " + String(sensors[0].currentValue) + ","
-      "\"sensor2\": " + String(sensors[1].currentValue) + ","
-      "\"sensor3\": " + String(sensors[2].currentValue) + ","
-      "\"leak_confirmed\": " + String(detectionState.leakDetected ? 1 : 0) + ","
-      "\"burst_confirmed\": " + String(detectionState.burstDetected ? 1 : 0) + ","
-      "\"leak_location\": \"" + detectionState.location + "\","
-      "\"confidence\": " + String(detectionState.confidence) + ","
-      "\"correlation_score\": " + String(detectionState.correlationScore) + ","
-      "\"environmental_noise\": " + String(detectionState.environmentalNoise ? 1 : 0) + ","
-      "\"active_sensors\": " + String(activeSensorCount) + ","
-      "\"burst_type\": \"" + detectionState.burstType + "\","
-      "\"burst_intensity\": " + String(detectionState.burstIntensity) + ","
-      "\"burst_dismissed\": " + String(burstDismissed ? 1 : 0) + ","
-      "\"timestamp\": " + String(currentMillis) +
-    "}";
-    
-    int httpResponseCode = http.POST(jsonData);
-    if (httpResponseCode > 0) {
-      Serial.print("HTTP Response: ");
-      Serial.println(httpResponseCode);
-    } else {
-      Serial.print("HTTP Error: ");
-      Serial.println(httpResponseCode);
-    }
-    http.end();
+    recordTelemetry(currentMillis, activeSensorCount);
+  }
+  if (telemetryBatch.ready(currentMillis)) {
+    transmitter.enqueue(telemetryBatch);
+    telemetryBatch.clear();
   }
   
   delay(50); // 50ms delay for responsive detection
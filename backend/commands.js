@@ -0,0 +1,158 @@
+// Downstream commands for the ESP32 devices, delivered by long-poll
+// (frame layout and device parser: dsp/command_codec.h).
+//
+// Each device holds one GET /api/commands?device=ID&after=SEQ&wait=MS open.
+// The request returns as soon as a command newer than SEQ is queued for the
+// device, or with 204 after MS. Commands stay queued until a later poll
+// acknowledges them through `after`, so a response lost in transit is sent
+// again.
+
+const FORMAT_VERSION = 1;
+const HEADER_BYTES = 4;
+const COMMAND_BYTES = 9;
+const MAX_QUEUED = 16;          // per device; matches commandBatchMax
+const MAX_WAIT_MS = 30000;
+const DEVICE_IDLE_MS = 10 * 60 * 1000;  // forget devices silent this long
+
+// Index = CommandType
+const COMMAND = {
+  DISMISS_BURST: 1,
+  CLEAR_DISMISS: 2,
+  PING: 3
+};
+
+// A Map, so inherited keys like "constructor" don't name a command
+const commandNames = new Map([
+  ['dismiss_burst', COMMAND.DISMISS_BURST],
+  ['clear_dismiss', COMMAND.CLEAR_DISMISS],
+  ['ping', COMMAND.PING]
+]);
+
+// The int32 argument of a command from a JSON number or decimal string, 0 when
+// absent, or null when it isn't an integer the frame can carry.
+function parseArgument(value) {
+  if (value === undefined || value === null) return 0;
+  if (typeof value === 'string' && /^-?\d{1,10}$/.test(value)) value = Number(value);
+  if (!Number.isInteger(value) || value < -0x80000000 || value > 0x7fffffff) return null;
+  return value;
+}
+
+function encodeCommands(commands) {
+  const buffer = Buffer.alloc(HEADER_BYTES + commands.length * COMMAND_BYTES);
+  buffer[0] = 0x4c; // 'L'
+  buffer[1] = 0x43; // 'C'
+  buffer[2] = FORMAT_VERSION;
+  buffer[3] = commands.length;
+  commands.forEach((command, i) => {
+    const offset = HEADER_BYTES + i * COMMAND_BYTES;
+    buffer.writeUInt32LE(command.sequence, offset);
+    buffer[offset + 4] = command.type;
+    buffer.writeInt32LE(command.argument, offset + 5);
+  });
+  return buffer;
+}
+
+function decodeCommands(buffer) {
+  if (buffer.length < HEADER_BYTES || buffer[0] !== 0x4c || buffer[1] !== 0x43) {
+    throw new Error('Not a command frame');
+  }
+  if (buffer[2] !== FORMAT_VERSION) throw new Error(`Unsupported command version ${buffer[2]}`);
+  const count = buffer[3];
+  if (buffer.length !== HEADER_BYTES + count * COMMAND_BYTES) throw new Error('Bad command frame length');
+  const commands = [];
+  for (let i = 0; i < count; i++) {
+    const offset = HEADER_BYTES + i * COMMAND_BYTES;
+    commands.push({
+      sequence: buffer.readUInt32LE(offset),
+      type: buffer[offset + 4],
+      argument: buffer.readInt32LE(offset + 5)
+    });
+  }
+  return commands;
+}
+
+class CommandHub {
+  constructor() {
+    this.sequence = 0;
+    this.devices = new Map();
+    this.stats = { polls: 0, immediate: 0, woken: 0, timedOut: 0, sent: 0 };
+  }
+
+  device(id) {
+    let device = this.devices.get(id);
+    if (!device) {
+      device = { queue: [], waiter: null, lastSeen: Date.now() };
+      this.devices.set(id, device);
+    }
+    return device;
+  }
+
+  // Queues a command for one device, or for every known device when id is
+  // null. Returns the command's sequence number.
+  send(type, argument = 0, id = null) {
+    const command = { sequence: ++this.sequence, type, argument };
+    this.stats.sent++;
+    const now = Date.now();
+    const targets = id === null ? [...this.devices.keys()] : [id];
+    for (const target of targets) {
+      const device = this.device(target);
+      if (id === null && !device.waiter && now - device.lastSeen > DEVICE_IDLE_MS) {
+        this.devices.delete(target);
+        continue;
+      }
+      device.queue.push(command);
+      if (device.queue.length > MAX_QUEUED) device.queue.shift();
+      if (device.waiter) this.wake(device, 'woken');
+    }
+    return command.sequence;
+  }
+
+  // Answers a device poll through respond(commands), now or once a command
+  // arrives or waitMs passes. cancel() on the result drops a closed request.
+  poll(id, after, waitMs, respond) {
+    this.stats.polls++;
+    const device = this.device(id);
+    device.lastSeen = Date.now();
+    // A sequence from before a server restart acknowledges nothing here
+    if (after > this.sequence) after = 0;
+    device.queue = device.queue.filter(command => command.sequence > after);
+
+    if (device.waiter) this.wake(device, 'timedOut'); // superseded poll
+    if (device.queue.length > 0 || waitMs <= 0) {
+      if (device.queue.length > 0) this.stats.immediate++;
+      else this.stats.timedOut++;
+      respond(device.queue.slice());
+      return { cancel() {} };
+    }
+
+    const waiter = { respond, timer: null };
+    waiter.timer = setTimeout(() => {
+      if (device.waiter === waiter) this.wake(device, 'timedOut');
+    }, Math.min(waitMs, MAX_WAIT_MS));
+    device.waiter = waiter;
+    return {
+      cancel() {
+        if (device.waiter !== waiter) return;
+        clearTimeout(waiter.timer);
+        device.waiter = null;
+      }
+    };
+  }
+
+  wake(device, outcome) {
+    const waiter = device.waiter;
+    device.waiter = null;
+    clearTimeout(waiter.timer);
+    this.stats[outcome]++;
+    device.lastSeen = Date.now();
+    waiter.respond(device.queue.slice());
+  }
+
+  snapshot() {
+    let waiting = 0;
+    for (const device of this.devices.values()) if (device.waiter) waiting++;
+    return { ...this.stats, devices: this.devices.size, waiting, sequence: this.sequence };
+  }
+}
+
+module.exports = { CommandHub, COMMAND, commandNames, parseArgument, encodeCommands, decodeCommands, MAX_WAIT_MS };
@@ -0,0 +1,745 @@
+// Database micro-benchmarks for the sqlite3 binding, on a scratch database
+// file shaped like sensor_data.
+//
+//   node db_bench.js ingest [--rows N] [--file PATH]
+//   node db_bench.js columns [--sizes N,N,...] [--file PATH]
+//   node db_bench.js reads [--rows N] [--file PATH]
+//   node db_bench.js cache [--rows N] [--file PATH]
+//   node db_bench.js pool [--rows N] [--file PATH]
+//   node db_bench.js export [--rows N] [--file PATH]
+//   node db_bench.js stats [--rows N] [--file PATH]
+//   node db_bench.js backup [--rows N] [--file PATH]
+//   node db_bench.js blobs [--sizes N,N,...] [--file PATH]
+//   node db_bench.js bind [--file PATH]
+//   node db_bench.js suite [--json PATH] [--baseline PATH] [--threshold PCT] [--file PATH]
+//
+// ingest: rows/s for the ways server.js can write readings --
+//   run       one db.run() per reading, each its own transaction
+//   txn       prepared statement run() per reading inside BEGIN/COMMIT
+//   multirow  multi-row INSERTs of up to 999 parameters (/api/data/batch)
+//   batch     Statement#runBatch, all readings in one work item
+// "run" fsyncs once per reading, so it gets at most 2000 of the rows.
+//
+// columns: the sensor1/2/3 history query read back with all() (one object
+// per row) and allColumns() (one typed array per column), per result size.
+//
+// reads: rows/s for SELECT * of the whole table through all() and each(),
+// and for get() of single readings by id on a prepared statement.
+//
+// cache: the /api/status and /api/history queries issued one after another
+// through db.get()/db.all(), with the statement cache off and on.
+//
+// pool: latency of the /api/history and /api/sensors reads while a writer
+// inserts readings back to back, in WAL mode without and with a read pool
+// (Database#openReaders).
+//
+// export: rows/s and peak RSS for a full scan of the table, each way of
+// reading it run in its own process (the internal "scan" scenario) --
+//   all       all() of the whole result
+//   each      each(), one callback per row
+//   stream    Database#stream, one object per row
+//   chunks    Database#stream with chunks: arrays of 1024 rows
+//   columns   Database#stream with columns: columnar batches of 1024 rows
+//
+// stats: cost of the per-SQL latency histograms (Database#stats), timing
+// the cache scenario's calls and a bare SELECT 1 with them off and on.
+//
+// backup: latency of batched inserts arriving at a fixed rate while the
+// database is copied --
+//   none      no copy, for reference
+//   whole     Backup#step(-1), the whole database in one step
+//   steps     Backup#step(1024) back to back
+//   snapshot  Database#snapshot, paced steps
+//
+// blobs: MB/s writing BLOBs of each size (in bytes) with Statement#run
+// inside one transaction, and reading them back with all() and get().
+//
+// bind: CPU and wall time per sensor_data INSERT (14 parameters) through
+// db.run(), a prepared statement's run() and runBatch, all inside one
+// transaction so that binding and stepping the row is what gets measured.
+//
+// suite: a fixed set of short measurements to compare builds of the binding
+// with: inserts, get/all/each by column type and result size, BLOB bind and
+// read, serialize vs parallelize, and callers contending for the thread
+// pool. --json saves the results; --baseline compares against saved ones and
+// exits with 1 if any is more than --threshold percent (10) worse.
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const sqlite3 = require('sqlite3');
+
+const DEFAULT_SIZES = '10000,100000,1000000';
+const options = {
+  rows: 100000, sizes: DEFAULT_SIZES, file: path.join(os.tmpdir(), 'db_bench.sqlite'), mode: '',
+  json: '', baseline: '', threshold: 10
+};
+const scenario = process.argv[2];
+for (let i = 3; i < process.argv.length; i += 2) {
+  const key = process.argv[i].replace(/^--/, '');
+  const value = process.argv[i + 1];
+  if (!(key in options) || value === undefined) usage();
+  options[key] = typeof options[key] === 'number' ? parseInt(value, 10) : value;
+}
+
+function usage() {
+  console.error('usage: node db_bench.js ingest [--rows N] [--file PATH]');
+  console.error('       node db_bench.js columns [--sizes N,N,...] [--file PATH]');
+  console.error('       node db_bench.js reads [--rows N] [--file PATH]');
+  console.error('       node db_bench.js cache [--rows N] [--file PATH]');
+  console.error('       node db_bench.js pool [--rows N] [--file PATH]');
+  console.error('       node db_bench.js export [--rows N] [--file PATH]');
+  console.error('       node db_bench.js stats [--rows N] [--file PATH]');
+  console.error('       node db_bench.js backup [--rows N] [--file PATH]');
+  console.error('       node db_bench.js blobs [--sizes N,N,...] [--file PATH]');
+  console.error('       node db_bench.js bind [--file PATH]');
+  console.error('       node db_bench.js suite [--json PATH] [--baseline PATH] [--threshold PCT] [--file PATH]');
+  process.exit(2);
+}
+
+const COLUMNS = [
+  'sensor1', 'sensor2', 'sensor3', 'leak_confirmed', 'burst_confirmed', 'leak_location', 'confidence',
+  'correlation_score', 'stability_score', 'environmental_noise', 'active_sensors', 'burst_type',
+  'burst_intensity', 'burst_dismissed'
+];
+const INSERT = `INSERT INTO sensor_data (${COLUMNS.join(', ')}) VALUES (${COLUMNS.map(() => '?').join(', ')})`;
+const RUN_ROWS = 2000;
+
+function reading(i) {
+  return [
+    400 + (i % 37), 410 + (i % 23), 405 + (i % 29), i % 50 === 0 ? 1 : 0, 0,
+    'Between Sensor 1 and 2', 72.5, 80, 90, 0, 3, 'NORMAL FLOW', 0, 0
+  ];
+}
+
+// Promise wrappers over the callback API
+function call(target, method, ...args) {
+  return new Promise((resolve, reject) => {
+    target[method](...args, function (err, result) {
+      if (err) reject(err);
+      else resolve(result === undefined ? this : result);
+    });
+  });
+}
+
+async function freshDatabase() {
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+  const db = new sqlite3.Database(options.file);
+  await call(db, 'run', `CREATE TABLE sensor_data (
+    id INTEGER PRIMARY KEY AUTOINCREMENT, timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,
+    sensor1 INTEGER, sensor2 INTEGER, sensor3 INTEGER, leak_confirmed INTEGER, burst_confirmed INTEGER,
+    leak_location TEXT, confidence REAL, correlation_score INTEGER, stability_score INTEGER,
+    environmental_noise INTEGER, active_sensors INTEGER, burst_type TEXT, burst_intensity REAL,
+    burst_dismissed INTEGER)`);
+  return db;
+}
+
+const ingest = {
+  async run(db, rows) {
+    await Promise.all(rows.map(row => call(db, 'run', INSERT, row)));
+  },
+
+  async txn(db, rows) {
+    const statement = db.prepare(INSERT);
+    await call(db, 'run', 'BEGIN');
+    await Promise.all(rows.map(row => call(statement, 'run', row)));
+    await call(db, 'run', 'COMMIT');
+    await call(statement, 'finalize');
+  },
+
+  async multirow(db, rows) {
+    const perStatement = Math.floor(999 / COLUMNS.length);
+    const pending = [];
+    for (let start = 0; start < rows.length; start += perStatement) {
+      const chunk = rows.slice(start, start + perStatement);
+      const values = chunk.map(() => `(${COLUMNS.map(() => '?').join(', ')})`).join(', ');
+      const sql = `INSERT INTO sensor_data (${COLUMNS.join(', ')}) VALUES ${values}`;
+      pending.push(call(db, 'run', sql, [].concat(...chunk)));
+    }
+    await Promise.all(pending);
+  },
+
+  async batch(db, rows) {
+    await call(db, 'runBatch', INSERT, rows);
+  }
+};
+
+async function runIngest() {
+  console.log(`ingest, ${options.rows} rows of ${COLUMNS.length} columns, ${options.file}`);
+  for (const [name, write] of Object.entries(ingest)) {
+    const count = name === 'run' ? Math.min(options.rows, RUN_ROWS) : options.rows;
+    const rows = Array.from({ length: count }, (_, i) => reading(i));
+    const db = await freshDatabase();
+    const start = process.hrtime.bigint();
+    await write(db, rows);
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    const stored = await call(db, 'get', 'SELECT COUNT(*) AS n FROM sensor_data');
+    await call(db, 'close');
+    if (stored.n !== count) throw new Error(`${name}: stored ${stored.n} of ${count} rows`);
+    console.log(`  ${name.padEnd(9)} ${String(count).padStart(7)} rows  ${(seconds * 1000).toFixed(1).padStart(9)} ms  ` +
+                `${Math.round(count / seconds).toString().padStart(9)} rows/s`);
+  }
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const HISTORY = 'SELECT sensor1, sensor2, sensor3, confidence, timestamp FROM sensor_data ORDER BY id DESC LIMIT ?';
+const READS = 5;
+
+// Best of READS runs, so a GC pause in one run does not decide the result
+async function timeRead(db, method, limit) {
+  let best = Infinity;
+  let result;
+  for (let i = 0; i < READS; i++) {
+    const start = process.hrtime.bigint();
+    result = await call(db, method, HISTORY, [limit]);
+    best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e9);
+  }
+  return { seconds: best, result };
+}
+
+async function runColumns() {
+  const sizes = options.sizes.split(',').map(n => parseInt(n, 10));
+  const largest = Math.max(...sizes);
+  console.log(`columns, ${HISTORY}, ${options.file}`);
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: largest }, (_, i) => reading(i)));
+  for (const size of sizes) {
+    const rows = await timeRead(db, 'all', size);
+    const columns = await timeRead(db, 'allColumns', size);
+    if (rows.result.length !== size || columns.result.length !== size ||
+        columns.result.columns.sensor1[size - 1] !== rows.result[size - 1].sensor1) {
+      throw new Error(`columns: results differ at ${size} rows`);
+    }
+    console.log(`  ${String(size).padStart(8)} rows  all ${(rows.seconds * 1000).toFixed(1).padStart(8)} ms  ` +
+                `allColumns ${(columns.seconds * 1000).toFixed(1).padStart(8)} ms  ` +
+                `${(rows.seconds / columns.seconds).toFixed(1).padStart(5)}x`);
+  }
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const GET_ROWS = 20000;
+
+const reads = {
+  async all(db) {
+    const rows = await call(db, 'all', 'SELECT * FROM sensor_data');
+    return rows.length;
+  },
+
+  async each(db) {
+    let count = 0;
+    await new Promise((resolve, reject) => {
+      db.each('SELECT * FROM sensor_data', (err) => {
+        if (err) reject(err);
+        count++;
+      }, (err) => (err ? reject(err) : resolve()));
+    });
+    return count;
+  },
+
+  async get(db) {
+    const statement = db.prepare('SELECT * FROM sensor_data WHERE id = ?');
+    const count = Math.min(options.rows, GET_ROWS);
+    for (let id = 1; id <= count; id++) {
+      const row = await call(statement, 'get', id);
+      if (row.id !== id) throw new Error(`get: row ${id} missing`);
+    }
+    await call(statement, 'finalize');
+    return count;
+  }
+};
+
+async function runReads() {
+  console.log(`reads, ${options.rows} rows of ${COLUMNS.length + 2} columns, ${options.file}`);
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: options.rows }, (_, i) => reading(i)));
+  for (const [name, read] of Object.entries(reads)) {
+    const start = process.hrtime.bigint();
+    const count = await read(db);
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    console.log(`  ${name.padEnd(9)} ${String(count).padStart(7)} rows  ${(seconds * 1000).toFixed(1).padStart(9)} ms  ` +
+                `${Math.round(count / seconds).toString().padStart(9)} rows/s`);
+  }
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const STATUS = 'SELECT * FROM sensor_data ORDER BY id DESC LIMIT 1';
+const RECENT = 'SELECT sensor1, sensor2, sensor3, timestamp FROM sensor_data ORDER BY id DESC LIMIT 20';
+const CACHE_CALLS = 20000;
+
+async function runCache() {
+  console.log(`cache, ${CACHE_CALLS} db.get/db.all calls on ${options.rows} rows, ${options.file}`);
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: options.rows }, (_, i) => reading(i)));
+  for (const capacity of [0, 16]) {
+    db.configure('statementCache', capacity);
+    const before = db.cacheStats();
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < CACHE_CALLS; i++) {
+      await call(db, i % 2 ? 'all' : 'get', i % 2 ? RECENT : STATUS);
+    }
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    const after = db.cacheStats();
+    console.log(`  capacity ${String(capacity).padStart(2)}  ${(seconds * 1e6 / CACHE_CALLS).toFixed(1).padStart(7)} us/call  ` +
+                `hits ${after.hits - before.hits}  misses ${after.misses - before.misses}`);
+  }
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const POOL_SECONDS = 5;
+const POOL_CLIENTS = 4;
+const DASHBOARD = [
+  'SELECT * FROM sensor_data ORDER BY id DESC LIMIT 50',
+  'SELECT sensor1, sensor2, sensor3, timestamp FROM sensor_data ORDER BY id DESC LIMIT 1'
+];
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function runPool() {
+  console.log(`pool, ${POOL_CLIENTS} readers against one writer for ${POOL_SECONDS}s on ${options.rows} rows, ${options.file}`);
+  for (const readers of [0, 2]) {
+    const db = await freshDatabase();
+    await call(db, 'exec', 'PRAGMA journal_mode=WAL');
+    await call(db, 'runBatch', INSERT, Array.from({ length: options.rows }, (_, i) => reading(i)));
+    if (readers) await call(db, 'openReaders', readers);
+
+    const end = Date.now() + POOL_SECONDS * 1000;
+    let writes = 0;
+    const writer = (async () => {
+      while (Date.now() < end) await call(db, 'run', INSERT, reading(writes++));
+    })();
+    const latencies = [];
+    const clients = Array.from({ length: POOL_CLIENTS }, async (_, c) => {
+      for (let i = c; Date.now() < end; i++) {
+        const start = process.hrtime.bigint();
+        await call(db, 'all', DASHBOARD[i % DASHBOARD.length]);
+        latencies.push(Number(process.hrtime.bigint() - start) / 1e6);
+      }
+    });
+    await Promise.all([writer, ...clients]);
+
+    latencies.sort((a, b) => a - b);
+    console.log(`  readers ${readers}  ${String(Math.round(latencies.length / POOL_SECONDS)).padStart(6)} reads/s  ` +
+                `p50 ${percentile(latencies, 0.5).toFixed(2).padStart(6)} ms  p99 ${percentile(latencies, 0.99).toFixed(2).padStart(6)} ms  ` +
+                `max ${latencies[latencies.length - 1].toFixed(2).padStart(7)} ms  ${String(Math.round(writes / POOL_SECONDS)).padStart(5)} writes/s`);
+    await call(db, 'close');
+  }
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const EXPORT = 'SELECT * FROM sensor_data';
+const EXPORT_CHUNK = 1024;
+
+const scans = {
+  all: (db) => call(db, 'all', EXPORT).then((rows) => rows.length),
+  each: (db) => new Promise((resolve, reject) => {
+    db.each(EXPORT, () => {}, (err, count) => (err ? reject(err) : resolve(count)));
+  }),
+  stream: (db) => countStream(db.stream(EXPORT, null, { chunkSize: EXPORT_CHUNK }), () => 1),
+  chunks: (db) => countStream(db.stream(EXPORT, null, { chunks: true, chunkSize: EXPORT_CHUNK }), (chunk) => chunk.length),
+  columns: (db) => countStream(db.stream(EXPORT, null, { columns: true, chunkSize: EXPORT_CHUNK }), (batch) => batch.length)
+};
+
+async function countStream(stream, size) {
+  let count = 0;
+  for await (const item of stream) count += size(item);
+  return count;
+}
+
+async function runExport() {
+  const { execFileSync } = require('child_process');
+  console.log(`export, SELECT * of ${options.rows} rows, ${options.file}`);
+  const db = await freshDatabase();
+  for (let done = 0; done < options.rows; done += 100000) {
+    const length = Math.min(100000, options.rows - done);
+    await call(db, 'runBatch', INSERT, Array.from({ length }, (_, i) => reading(done + i)));
+  }
+  await call(db, 'close');
+  for (const mode of Object.keys(scans)) {
+    process.stdout.write(execFileSync(process.execPath, [__filename, 'scan', '--mode', mode, '--file', options.file]));
+  }
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+async function runScan() {
+  if (!scans[options.mode]) usage();
+  const db = new sqlite3.Database(options.file, sqlite3.OPEN_READONLY);
+  const baseline = process.memoryUsage().rss;
+  const start = process.hrtime.bigint();
+  const count = await scans[options.mode](db);
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  const peak = process.resourceUsage().maxRSS * 1024;
+  console.log(`  ${options.mode.padEnd(8)} ${String(count).padStart(8)} rows  ${(seconds * 1000).toFixed(1).padStart(8)} ms  ` +
+              `${String(Math.round(count / seconds)).padStart(9)} rows/s  peak RSS +${((peak - baseline) / 1048576).toFixed(0).padStart(5)} MiB`);
+  await call(db, 'close');
+}
+
+const STATS_ROUNDS = 5;
+
+async function timeCalls(db, calls) {
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < CACHE_CALLS; i++) await calls(i);
+  return Number(process.hrtime.bigint() - start) / 1e3 / CACHE_CALLS;
+}
+
+async function runStats() {
+  console.log(`stats, ${CACHE_CALLS} calls per round, best of ${STATS_ROUNDS} on ${options.rows} rows, ${options.file}`);
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: options.rows }, (_, i) => reading(i)));
+  const workloads = {
+    'status/history': (i) => call(db, i % 2 ? 'all' : 'get', i % 2 ? RECENT : STATUS),
+    'SELECT 1': () => call(db, 'get', 'SELECT 1')
+  };
+  for (const [name, calls] of Object.entries(workloads)) {
+    const best = { off: Infinity, on: Infinity };
+    // Alternate so drift affects both settings alike.
+    for (let round = 0; round < STATS_ROUNDS; round++) {
+      for (const setting of ['off', 'on']) {
+        db.configure('stats', setting === 'on');
+        best[setting] = Math.min(best[setting], await timeCalls(db, calls));
+      }
+    }
+    const overhead = (best.on - best.off) / best.off * 100;
+    console.log(`  ${name.padEnd(15)} off ${best.off.toFixed(2).padStart(6)} us/call  on ${best.on.toFixed(2).padStart(6)} us/call  ` +
+                `${overhead >= 0 ? '+' : ''}${overhead.toFixed(1)}%`);
+  }
+  const stats = db.stats();
+  for (const statement of stats.statements) {
+    const phases = ['queue', 'pool', 'work', 'loop', 'marshal', 'callback', 'total'];
+    console.log(`  ${statement.sql.replace(/\s+/g, ' ').slice(0, 40).padEnd(40)} p50 ` + phases.map((p) => `${p} ${(statement[p].p50 * 1000).toFixed(1)}`).join(' ') + ' us');
+  }
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+const BIND_ROWS = 20000;
+const BIND_ROUNDS = 5;
+
+const inserts = {
+  run: (db, rows) => Promise.all(rows.map(row => call(db, 'run', INSERT, row))),
+  prepared: (db, rows, statement) => Promise.all(rows.map(row => call(statement, 'run', row))),
+  batch: (db, rows) => call(db, 'runBatch', INSERT, rows)
+};
+
+async function runBind() {
+  console.log(`bind, ${BIND_ROWS} inserts per round, best of ${BIND_ROUNDS}, ${options.file}`);
+  const db = await freshDatabase();
+  const statement = db.prepare(INSERT);
+  const rows = Array.from({ length: BIND_ROWS }, (_, i) => reading(i));
+  const best = {};
+  // Alternate so drift affects every way alike.
+  for (let round = 0; round < BIND_ROUNDS; round++) {
+    for (const [name, insert] of Object.entries(inserts)) {
+      await call(db, 'run', 'BEGIN');
+      const cpu = process.cpuUsage();
+      const start = process.hrtime.bigint();
+      await insert(db, rows, statement);
+      const wall = Number(process.hrtime.bigint() - start) / 1e3 / BIND_ROWS;
+      const used = process.cpuUsage(cpu);
+      await call(db, 'run', 'COMMIT');
+      const result = { cpu: (used.user + used.system) / BIND_ROWS, wall };
+      if (!best[name] || result.cpu < best[name].cpu) best[name] = result;
+    }
+  }
+  for (const [name, { cpu, wall }] of Object.entries(best)) {
+    console.log(`  ${name.padEnd(9)} cpu ${cpu.toFixed(2).padStart(6)} us/insert  wall ${wall.toFixed(2).padStart(6)} us/insert`);
+  }
+  await call(statement, 'finalize');
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+// Batches of readings as /api/data/batch gets them, at a higher rate than
+// the devices' 10 Hz so that a short run still yields a stable p99.
+const BACKUP_HZ = 100;
+const BACKUP_BATCH = 10;
+const BACKUP_IDLE_SECONDS = 10;
+
+const copies = {
+  none: () => new Promise((resolve) => setTimeout(resolve, BACKUP_IDLE_SECONDS * 1000)),
+  whole: (db, file) => stepBackup(db.backup(file), -1),
+  steps: (db, file) => stepBackup(db.backup(file), 1024),
+  snapshot: (db, file) => call(db, 'snapshot', file)
+};
+
+async function stepBackup(backup, pages) {
+  while (!(await call(backup, 'step', pages)));
+  await call(backup, 'finish');
+}
+
+async function runBackup() {
+  const copy = options.file + '.copy';
+  console.log(`backup, ${BACKUP_BATCH}-row batches at ${BACKUP_HZ} Hz while copying ${options.rows} rows, ${options.file}`);
+  const db = await freshDatabase();
+  for (let done = 0; done < options.rows; done += 100000) {
+    const length = Math.min(100000, options.rows - done);
+    await call(db, 'runBatch', INSERT, Array.from({ length }, (_, i) => reading(done + i)));
+  }
+  console.log(`  ${(fs.statSync(options.file).size / 1048576).toFixed(0)} MiB`);
+
+  for (const [name, run] of Object.entries(copies)) {
+    const latencies = [];
+    let sent = 0;
+    const timer = setInterval(() => {
+      const start = process.hrtime.bigint();
+      const rows = Array.from({ length: BACKUP_BATCH }, () => reading(sent++));
+      db.runBatch(INSERT, rows, () => latencies.push(Number(process.hrtime.bigint() - start) / 1e6));
+    }, 1000 / BACKUP_HZ);
+    const start = Date.now();
+    await run(db, copy);
+    const seconds = (Date.now() - start) / 1000;
+    clearInterval(timer);
+    await call(db, 'wait');
+
+    latencies.sort((a, b) => a - b);
+    console.log(`  ${name.padEnd(8)} ${seconds.toFixed(1).padStart(6)} s  ${String(latencies.length).padStart(6)} batches  ` +
+                `p50 ${percentile(latencies, 0.5).toFixed(2).padStart(7)} ms  p99 ${percentile(latencies, 0.99).toFixed(2).padStart(7)} ms  ` +
+                `max ${latencies[latencies.length - 1].toFixed(2).padStart(8)} ms`);
+    fs.rmSync(copy, { force: true });
+  }
+  await call(db, 'close');
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+// Like the waveform captures: payloads are BLOBs of a few KB up to 1 MB.
+const BLOB_SIZES = '1024,16384,262144,1048576';
+const BLOB_BYTES = 128 * 1048576;
+const BLOB_ROUNDS = 3;
+
+async function timeMBs(bytes, run) {
+  let best = Infinity;
+  for (let round = 0; round < BLOB_ROUNDS; round++) {
+    const start = process.hrtime.bigint();
+    await run();
+    best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e9);
+  }
+  return bytes / 1048576 / best;
+}
+
+async function runBlobs() {
+  const sizes = (options.sizes === DEFAULT_SIZES ? BLOB_SIZES : options.sizes).split(',').map(Number);
+  console.log(`blobs, ${BLOB_BYTES / 1048576} MiB per size, best of ${BLOB_ROUNDS}, ${options.file}`);
+  for (const size of sizes) {
+    const count = Math.max(1, Math.floor(BLOB_BYTES / size));
+    const payloads = Array.from({ length: 16 }, (_, i) => Buffer.alloc(size, i));
+    for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+    const db = new sqlite3.Database(options.file);
+    await call(db, 'exec', 'PRAGMA journal_mode=WAL; CREATE TABLE blobs (id INTEGER PRIMARY KEY, payload BLOB)');
+
+    const insert = db.prepare('INSERT INTO blobs (payload) VALUES (?)');
+    const write = await timeMBs(count * size, async () => {
+      await call(db, 'exec', 'BEGIN; DELETE FROM blobs');
+      await Promise.all(Array.from({ length: count }, (_, i) => call(insert, 'run', payloads[i % payloads.length])));
+      await call(db, 'exec', 'COMMIT');
+    });
+    await call(insert, 'finalize');
+
+    const readAll = await timeMBs(count * size, async () => {
+      const rows = await call(db, 'all', 'SELECT payload FROM blobs');
+      if (rows.length !== count || rows[0].payload.length !== size) throw new Error('short read');
+    });
+    const select = db.prepare('SELECT payload FROM blobs WHERE id = ?');
+    const first = (await call(db, 'get', 'SELECT min(id) AS id FROM blobs')).id;
+    const readGet = await timeMBs(count * size, () =>
+      Promise.all(Array.from({ length: count }, (_, i) => call(select, 'get', first + i))));
+    await call(select, 'finalize');
+
+    console.log(`  ${String(size).padStart(8)} B x ${String(count).padStart(6)}  write ${write.toFixed(0).padStart(6)} MB/s  ` +
+                `all ${readAll.toFixed(0).padStart(6)} MB/s  get ${readGet.toFixed(0).padStart(6)} MB/s`);
+    await call(db, 'close');
+  }
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+}
+
+// Every measurement is taken once per pass and the best pass counts, so the
+// samples of one measurement are spread over the whole run rather than
+// taken back to back through the same slow spell of a noisy machine.
+const SUITE_PASSES = 3;
+const SUITE_ROUND_MS = 300;
+const SUITE_TYPES = {
+  integer: 'id, sensor1, sensor2, sensor3, active_sensors',
+  real: 'confidence, burst_intensity',
+  text: 'leak_location, burst_type, timestamp',
+  row: '*'
+};
+const SUITE_SIZES = [100, 10000];
+const SUITE_BLOBS = [1024, 65536, 1048576];
+const SUITE_CALLERS = [1, 4, 16, 64];
+
+// Units per second of work (which returns the units it did), repeated for at
+// least SUITE_ROUND_MS.
+async function rate(work) {
+  const start = process.hrtime.bigint();
+  let units = 0;
+  let seconds;
+  do {
+    units += await work();
+    seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  } while (seconds * 1000 < SUITE_ROUND_MS);
+  return units / seconds;
+}
+
+// callers closed loops of op for SUITE_ROUND_MS: calls/s and p99 latency.
+async function contend(callers, op) {
+  const latencies = [];
+  const end = Date.now() + SUITE_ROUND_MS;
+  const start = process.hrtime.bigint();
+  await Promise.all(Array.from({ length: callers }, async () => {
+    while (Date.now() < end) {
+      const begin = process.hrtime.bigint();
+      await op();
+      latencies.push(Number(process.hrtime.bigint() - begin) / 1e6);
+    }
+  }));
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  latencies.sort((a, b) => a - b);
+  return { rate: latencies.length / seconds, p99: percentile(latencies, 0.99) };
+}
+
+async function suiteInserts(record) {
+  for (const [name, count] of [['run', 200], ['txn', 5000], ['batch', 5000]]) {
+    const db = await freshDatabase();
+    let next = 0;
+    record(`insert.${name}`, await rate(async () => {
+      await ingest[name](db, Array.from({ length: count }, () => reading(next++)));
+      return count;
+    }), 'rows/s');
+    await call(db, 'close');
+  }
+}
+
+async function suiteReads(record) {
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: Math.max(...SUITE_SIZES) }, (_, i) => reading(i)));
+  for (const [type, columns] of Object.entries(SUITE_TYPES)) {
+    const sql = `SELECT ${columns} FROM sensor_data LIMIT ?`;
+    for (const size of SUITE_SIZES) {
+      record(`read.all.${type}.${size}`, await rate(async () => (await call(db, 'all', sql, size)).length), 'rows/s');
+      record(`read.each.${type}.${size}`, await rate(() => new Promise((resolve, reject) => {
+        db.each(sql, size, () => {}, (err, count) => (err ? reject(err) : resolve(count)));
+      })), 'rows/s');
+    }
+    const statement = db.prepare(`SELECT ${columns} FROM sensor_data WHERE id = ?`);
+    let id = 0;
+    record(`read.get.${type}`, await rate(async () => {
+      await call(statement, 'get', (id++ % 10000) + 1);
+      return 1;
+    }), 'calls/s');
+    await call(statement, 'finalize');
+  }
+  await call(db, 'close');
+}
+
+async function suiteBlobs(record) {
+  const db = await freshDatabase();
+  await call(db, 'exec', 'CREATE TABLE blobs (id INTEGER PRIMARY KEY, payload BLOB)');
+  for (const size of SUITE_BLOBS) {
+    const payload = Buffer.alloc(size, size & 0xff);
+    const count = Math.max(1, Math.floor(4194304 / size));
+    const insert = db.prepare('INSERT INTO blobs (payload) VALUES (?)');
+    record(`blob.bind.${size}`, await rate(async () => {
+      await call(db, 'exec', 'BEGIN; DELETE FROM blobs');
+      await Promise.all(Array.from({ length: count }, () => call(insert, 'run', payload)));
+      await call(db, 'exec', 'COMMIT');
+      return count * size / 1048576;
+    }), 'MB/s');
+    await call(insert, 'finalize');
+    record(`blob.read.${size}`, await rate(async () => {
+      const rows = await call(db, 'all', 'SELECT payload FROM blobs');
+      return rows.length * size / 1048576;
+    }), 'MB/s');
+  }
+  await call(db, 'close');
+}
+
+async function suiteScheduler(record) {
+  const db = await freshDatabase();
+  await call(db, 'runBatch', INSERT, Array.from({ length: 1000 }, (_, i) => reading(i)));
+  for (const mode of ['serialize', 'parallelize']) {
+    db[mode]();
+    record(`sched.${mode}`, (await contend(32, () => call(db, 'get', STATUS))).rate, 'calls/s');
+  }
+  for (const callers of SUITE_CALLERS) {
+    const result = await contend(callers, () => call(db, 'all', RECENT));
+    record(`pool.${callers}`, result.rate, 'calls/s');
+    record(`pool.${callers}.p99`, result.p99, 'ms', 'lower');
+  }
+  await call(db, 'close');
+}
+
+function formatValue(value) {
+  return value >= 100 ? value.toFixed(0) : value.toPrecision(3);
+}
+
+async function runSuite() {
+  const baseline = options.baseline ? JSON.parse(fs.readFileSync(options.baseline, 'utf8')).results : null;
+  const report = {
+    node: process.version, sqlite: sqlite3.VERSION, platform: `${os.platform()} ${os.arch()}`, cpus: os.cpus().length,
+    threadpool: parseInt(process.env.UV_THREADPOOL_SIZE || '4', 10), date: new Date().toISOString(), results: {}
+  };
+  console.log(`suite, best of ${SUITE_PASSES} passes of ${SUITE_ROUND_MS} ms rounds, ${options.file}` +
+              (baseline ? `, against ${options.baseline}` : ''));
+
+  function record(name, value, unit, better = 'higher') {
+    const result = report.results[name];
+    if (!result || (better === 'higher' ? value > result.value : value < result.value)) {
+      report.results[name] = { value, unit, better };
+    }
+  }
+
+  for (let pass = 0; pass < SUITE_PASSES; pass++) {
+    await suiteInserts(record);
+    await suiteReads(record);
+    await suiteBlobs(record);
+    await suiteScheduler(record);
+  }
+  for (const suffix of ['', '-journal', '-wal', '-shm']) fs.rmSync(options.file + suffix, { force: true });
+
+  const regressions = [];
+  const changes = [];
+  for (const [name, { value, unit, better }] of Object.entries(report.results)) {
+    let line = `  ${name.padEnd(24)} ${formatValue(value).padStart(9)} ${unit.padEnd(7)}`;
+    const base = baseline && baseline[name];
+    if (base) {
+      const change = (value - base.value) / base.value * 100;
+      const worse = better === 'higher' ? -change : change;
+      changes.push(-worse);
+      line += `  baseline ${formatValue(base.value).padStart(9)}  ${change >= 0 ? '+' : ''}${change.toFixed(1)}%`;
+      if (worse > options.threshold) {
+        regressions.push(name);
+        line += '  REGRESSION';
+      }
+    }
+    console.log(line.trimEnd());
+  }
+
+  if (options.json) {
+    fs.writeFileSync(options.json, JSON.stringify(report, null, 2) + '\n');
+    console.log(`  saved ${Object.keys(report.results).length} results to ${options.json}`);
+  }
+  if (changes.length) {
+    // A shift shared by every result points at the machine, not the change.
+    changes.sort((a, b) => a - b);
+    const median = changes[Math.floor(changes.length / 2)];
+    console.log(`  median change ${median >= 0 ? '+' : ''}${median.toFixed(1)}% (positive is better)`);
+  }
+  if (regressions.length) {
+    console.log(`  ${regressions.length} worse than baseline by more than ${options.threshold}%: ${regressions.join(', ')}`);
+    process.exitCode = 1;
+  }
+}
+
+const scenarios = {
+  ingest: runIngest, columns: runColumns, reads: runReads, cache: runCache, pool: runPool,
+  export: runExport, scan: runScan, stats: runStats, backup: runBackup, blobs: runBlobs,
+  bind: runBind, suite: runSuite
+};
+if (!scenarios[scenario]) usage();
+scenarios[scenario]().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,161 @@
+// Simulated device fleet for the dismiss/command path. Runs against a live
+// backend (npm start) and reports how long a dashboard dismiss takes to reach
+// every device, and how many requests the devices make to learn about it.
+//
+//   node device_sim.js [--devices N] [--commands K] [--interval MS]
+//                      [--mode longpoll|poll] [--host H] [--port P]
+//
+// longpoll: each device holds GET /api/commands open (the current firmware).
+// poll:     each device fetches GET /api/status every second and looks for
+//           "burst_dismissed":true (the firmware before the command channel).
+//
+// The controller sends K dismisses, --interval ms apart. Before each one it
+// posts a normal reading so the latest row is not yet dismissed.
+
+const http = require('http');
+const { COMMAND, decodeCommands } = require('./commands');
+
+const options = { devices: 20, commands: 10, interval: 2000, mode: 'longpoll', host: 'localhost', port: 5000 };
+for (let i = 2; i < process.argv.length; i += 2) {
+  const key = process.argv[i].replace(/^--/, '');
+  const value = process.argv[i + 1];
+  if (!(key in options) || value === undefined) {
+    console.error('usage: node device_sim.js [--devices N] [--commands K] [--interval MS] ' +
+                  '[--mode longpoll|poll] [--host H] [--port P]');
+    process.exit(2);
+  }
+  options[key] = typeof options[key] === 'number' ? parseInt(value, 10) : value;
+}
+
+const POLL_MS = 1000;
+const WAIT_MS = 25000;
+const agent = new http.Agent({ keepAlive: true, maxSockets: Infinity });
+
+function request(method, path, body) {
+  return new Promise((resolve, reject) => {
+    const payload = body === undefined ? null : Buffer.from(JSON.stringify(body));
+    const req = http.request({
+      host: options.host, port: options.port, method, path, agent,
+      headers: payload ? { 'Content-Type': 'application/json', 'Content-Length': payload.length } : {}
+    }, (res) => {
+      const chunks = [];
+      res.on('data', chunk => chunks.push(chunk));
+      res.on('end', () => resolve({ status: res.statusCode, body: Buffer.concat(chunks) }));
+    });
+    req.on('error', reject);
+    if (payload) req.write(payload);
+    req.end();
+  });
+}
+
+// sent[k] = time dismiss k was posted; latencies collects per-device delays
+const sent = [];
+const latencies = [];
+let deviceRequests = 0;
+let running = true;
+
+function delivered(device, now) {
+  const k = sent.length - 1;
+  if (k < 0 || device.seen >= k) return;
+  device.seen = k;
+  latencies.push(now - sent[k]);
+}
+
+async function longPollDevice(device) {
+  let after = 0;
+  while (running) {
+    deviceRequests++;
+    let res;
+    try {
+      res = await request('GET', `/api/commands?device=${device.id}&after=${after}&wait=${WAIT_MS}`);
+    } catch (err) {
+      if (running) await sleep(1000);
+      continue;
+    }
+    if (res.status !== 200) continue;
+    const now = Date.now();
+    for (const command of decodeCommands(res.body)) {
+      if (command.type === COMMAND.DISMISS_BURST) delivered(device, now);
+      after = command.sequence;
+    }
+  }
+}
+
+async function statusPollDevice(device) {
+  await sleep(Math.random() * POLL_MS);  // devices boot at different times
+  while (running) {
+    const started = Date.now();
+    deviceRequests++;
+    try {
+      const res = await request('GET', '/api/status');
+      // Only a request made after the dismiss can see it
+      const k = sent.length - 1;
+      if (k >= 0 && started >= sent[k] && res.body.toString().indexOf('"burst_dismissed":true') !== -1) {
+        delivered(device, Date.now());
+      }
+    } catch (err) {
+      // server busy or restarting; try again next period
+    }
+    await sleep(Math.max(0, POLL_MS - (Date.now() - started)));
+  }
+}
+
+function sleep(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+async function main() {
+  if (options.mode !== 'longpoll' && options.mode !== 'poll') {
+    console.error(`unknown mode ${options.mode}`);
+    process.exit(2);
+  }
+  const devices = [];
+  for (let i = 0; i < options.devices; i++) devices.push({ id: `sim-${i}`, seen: -1 });
+  const tasks = devices.map(d => (options.mode === 'longpoll' ? longPollDevice(d) : statusPollDevice(d)));
+
+  await sleep(Math.max(POLL_MS, 200));  // let every device register
+  const startedAt = Date.now();
+  const requestsAtStart = deviceRequests;
+  for (let k = 0; k < options.commands; k++) {
+    await request('POST', '/api/data', {
+      sensor1: 0, sensor2: 0, sensor3: 0, leak_confirmed: 0, burst_confirmed: 0,
+      leak_location: 'No leak detected', confidence: 0, correlation_score: 0, stability_score: 0,
+      environmental_noise: 0, active_sensors: 0
+    });
+    sent.push(Date.now());
+    await request('POST', '/api/dismiss');
+    await sleep(options.interval);
+  }
+  const seconds = (Date.now() - startedAt) / 1000;
+  const requests = deviceRequests - requestsAtStart;
+
+  running = false;
+  let stats = null;
+  try {
+    stats = JSON.parse((await request('GET', '/api/commands/stats')).body.toString());
+  } catch (err) {
+    // older backend without the command channel
+  }
+  agent.destroy();
+  await Promise.allSettled(tasks);
+
+  const sorted = latencies.slice().sort((a, b) => a - b);
+  const expected = options.devices * options.commands;
+  console.log(`mode ${options.mode}: ${options.devices} devices, ${options.commands} dismisses ` +
+              `${options.interval} ms apart`);
+  console.log(`dismiss latency: p50 ${percentile(sorted, 0.5)} ms, p95 ${percentile(sorted, 0.95)} ms, ` +
+              `max ${sorted.length ? sorted[sorted.length - 1] : 0} ms (${latencies.length}/${expected} delivered)`);
+  console.log(`device requests: ${requests} in ${seconds.toFixed(1)} s, ${(requests / seconds).toFixed(1)}/s ` +
+              `(${(requests / seconds / options.devices).toFixed(2)} per device per second)`);
+  if (stats) console.log('command hub:', JSON.stringify(stats));
+}
+
+main().catch((err) => {
+  console.error(err.message);
+  process.exit(1);
+});
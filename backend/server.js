@@ -1,10 +1,31 @@
 const express = require('express');
 const cors = require('cors');
-const sqlite3 = require('sqlite3').verbose();
+const sqlite3 = require('sqlite3');
+// Statement#runBatch binds and steps every row in one transaction on the
+// worker thread. A prebuilt binding without it gets one multi-row INSERT,
+// which has to stay under SQLite's default 999-variable limit. Checked before
+// verbose(), which wraps runBatch whether or not the binding has it.
+const nativeBatch = typeof sqlite3.Statement.prototype.runBatch === 'function';
+sqlite3.verbose();
+const fs = require('fs');
 const path = require('path');
+const { decodeBatch, deviceTime } = require('./telemetry');
+const { decodeWaveform } = require('./waveform');
+const { CommandHub, COMMAND, commandNames, parseArgument, encodeCommands, MAX_WAIT_MS } = require('./commands');
 
 const app = express();
 const PORT = 5000;
+const commands = new CommandHub();
+
+// Devices report by exception: a reading stands until the next one, and a
+// quiet device still sends one every HEARTBEAT_MS (reportHeartbeatMs in
+// dsp/report_by_exception.h). Silence for STALE_AFTER_MS means it is offline.
+const HEARTBEAT_MS = 60000;
+const STALE_AFTER_MS = 3 * HEARTBEAT_MS;
+
+// Per-sensor window summary columns (NULL for plain readings)
+const SUMMARY_FIELDS = ['min', 'max', 'rms', 'band'];
+const SUMMARY_COLUMNS = [1, 2, 3].flatMap((n) => SUMMARY_FIELDS.map((f) => `sensor${n}_${f}`));
 
 // Middleware
 app.use(cors());
@@ -14,6 +35,42 @@ app.use(express.json());
 const dbPath = path.join(__dirname, 'data.db');
 const db = new sqlite3.Database(dbPath);
 
+// Opt-in WAL read pool (DB_READERS connections) so the dashboard queries do
+// not wait behind device inserts.
+const DB_READERS = parseInt(process.env.DB_READERS || '0', 10);
+if (DB_READERS > 0 && typeof db.openReaders === 'function') {
+  db.openReaders(DB_READERS, (err) => {
+    if (err) console.error('Read pool not opened:', err.message);
+  });
+}
+
+// Opt-in rotated snapshots of data.db into DB_SNAPSHOT_DIR every
+// DB_SNAPSHOT_MINUTES, keeping the newest DB_SNAPSHOT_KEEP. Database#snapshot
+// copies in short paced steps, so inserts carry on during the copy.
+const DB_SNAPSHOT_DIR = process.env.DB_SNAPSHOT_DIR;
+const DB_SNAPSHOT_MINUTES = parseFloat(process.env.DB_SNAPSHOT_MINUTES || '60');
+const DB_SNAPSHOT_KEEP = parseInt(process.env.DB_SNAPSHOT_KEEP || '24', 10);
+const SNAPSHOT_NAME = /^data-\d{8}T\d{6}Z\.db$/;
+let snapshotRunning = false;
+
+function takeSnapshot() {
+  if (snapshotRunning) return;
+  snapshotRunning = true;
+  const stamp = new Date().toISOString().replace(/[-:]/g, '').replace(/\.\d+Z$/, 'Z');
+  db.snapshot(path.join(DB_SNAPSHOT_DIR, `data-${stamp}.db`), (err, result) => {
+    snapshotRunning = false;
+    if (err) return console.error('Snapshot failed:', err.message);
+    console.log(`Snapshot data-${stamp}.db: ${result.pages} pages in ${result.elapsed} ms, ${result.restarts} restarts`);
+    const old = fs.readdirSync(DB_SNAPSHOT_DIR).filter((name) => SNAPSHOT_NAME.test(name)).sort().slice(0, -DB_SNAPSHOT_KEEP);
+    for (const name of old) fs.rmSync(path.join(DB_SNAPSHOT_DIR, name), { force: true });
+  });
+}
+
+if (DB_SNAPSHOT_DIR && typeof db.snapshot === 'function') {
+  fs.mkdirSync(DB_SNAPSHOT_DIR, { recursive: true });
+  setInterval(takeSnapshot, DB_SNAPSHOT_MINUTES * 60000).unref();
+}
+
 db.serialize(() => {
   // Check if table exists and has the correct schema
   db.get("PRAGMA table_info(sensor_data)", (err, rows) => {
@@ -45,9 +102,28 @@ db.serialize(() => {
         } else {
           console.log('Table already has correct schema, continuing...');
         }
+        if (!hasOldSchema && columns.length > 0) addSummaryColumns(columns);
       });
     }
   });
+
+  // Raw pre/post-trigger waveforms uploaded on detection events (see waveform.js)
+  db.run(`
+    CREATE TABLE IF NOT EXISTS waveform_captures (
+      id INTEGER PRIMARY KEY AUTOINCREMENT,
+      event_id INTEGER REFERENCES sensor_data(id),
+      trigger_time_ms INTEGER NOT NULL,
+      sample_rate INTEGER NOT NULL,
+      sensor_count INTEGER NOT NULL,
+      frame_count INTEGER NOT NULL,
+      trigger_frame INTEGER NOT NULL,
+      burst_type TEXT,
+      data BLOB NOT NULL,
+      created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+    )
+  `, (err) => {
+    if (err) console.error('Error creating waveform_captures table:', err);
+  });
 });
 
 function createNewTable() {
@@ -68,6 +144,8 @@ function createNewTable() {
       burst_type TEXT DEFAULT 'NORMAL FLOW',
       burst_intensity REAL DEFAULT 0,
       burst_dismissed INTEGER DEFAULT 0,
+      ${SUMMARY_COLUMNS.map((c) => `${c} INTEGER,`).join('\n      ')}
+      heartbeat INTEGER DEFAULT 0,
       timestamp DATETIME DEFAULT CURRENT_TIMESTAMP
     )
   `, (err) => {
@@ -101,6 +179,36 @@ function addBurstDismissedColumn() {
   });
 }
 
+function addSummaryColumns(columns) {
+  const present = new Set(columns.map((col) => col.name));
+  const missing = SUMMARY_COLUMNS.map((c) => [c, 'INTEGER'])
+    .concat([['heartbeat', 'INTEGER DEFAULT 0']])
+    .filter(([name]) => !present.has(name));
+  for (const [name, type] of missing) {
+    db.run(`ALTER TABLE sensor_data ADD COLUMN ${name} ${type}`, (err) => {
+      if (err) console.error(`Error adding ${name} column:`, err);
+    });
+  }
+  if (missing.length > 0) console.log(`✅ Added ${missing.length} window summary columns`);
+}
+
+// SQLite DATETIME (UTC, no zone) to epoch milliseconds
+function sqliteMs(timestamp) {
+  return new Date(timestamp + 'Z').getTime();
+}
+
+// Readings hold until the next one; the newest holds until now unless the
+// device has gone silent for longer than STALE_AFTER_MS.
+function withHoldUntil(rows) {
+  const now = Date.now();
+  return rows.map((row, i) => {
+    const next = rows[i + 1];
+    let until = next ? sqliteMs(next.timestamp) : now;
+    if (!next && now - sqliteMs(row.timestamp) > STALE_AFTER_MS) until = sqliteMs(row.timestamp);
+    return { ...row, until: row.timestamp ? new Date(until).toISOString() : null };
+  });
+}
+
 // POST /api/data - receive sensor data from ESP32
 app.post('/api/data', (req, res) => {
   const { 
@@ -149,6 +257,173 @@ app.post('/api/data', (req, res) => {
   );
 });
 
+const READING_COLUMNS = `sensor1, sensor2, sensor3,
+      leak_confirmed, burst_confirmed,
+      leak_location, confidence,
+      correlation_score, stability_score,
+      environmental_noise, active_sensors,
+      burst_type, burst_intensity, burst_dismissed,
+      ${SUMMARY_COLUMNS.join(', ')},
+      heartbeat, timestamp`;
+const READING_PARAMS = 16 + SUMMARY_COLUMNS.length;
+const READING_ROW = `(${new Array(READING_PARAMS).fill('?').join(', ')})`;
+
+const MAX_MULTIROW = Math.floor(999 / READING_PARAMS);
+
+function insertReadings(rows, callback) {
+  if (nativeBatch) {
+    return db.runBatch(`INSERT INTO sensor_data (${READING_COLUMNS}) VALUES ${READING_ROW}`, rows, callback);
+  }
+  db.run(
+    `INSERT INTO sensor_data (${READING_COLUMNS}) VALUES ${rows.map(() => READING_ROW).join(', ')}`,
+    [].concat(...rows),
+    callback
+  );
+}
+
+// The device's millis() when it sent the request, or null without the header
+function deviceSentMs(req) {
+  const value = req.get('X-Device-Ms');
+  if (!value || !/^\d{1,10}$/.test(value)) return null;
+  const ms = Number(value);
+  return ms <= 0xffffffff ? ms : null;
+}
+
+// POST /api/data/batch - binary telemetry batch from ESP32 (see telemetry.js)
+app.post('/api/data/batch', express.raw({ type: 'application/octet-stream', limit: '16kb' }), (req, res) => {
+  let records;
+  try {
+    records = decodeBatch(req.body, new Date(), deviceSentMs(req));
+  } catch (err) {
+    return res.status(400).json({ error: err.message });
+  }
+  if (records.length === 0) {
+    return res.json({ success: true, count: 0 });
+  }
+  if (records[0].sensors.length !== 3) {
+    return res.status(400).json({ error: 'Invalid sensor count' });
+  }
+  if (!nativeBatch && records.length > MAX_MULTIROW) {
+    return res.status(413).json({ error: 'Too many records in batch' });
+  }
+
+  const rows = records.map((r) => {
+    const row = [
+      r.sensors[0], r.sensors[1], r.sensors[2],
+      r.leak_confirmed, r.burst_confirmed,
+      r.leak_location, r.confidence,
+      r.correlation_score, r.stability_score,
+      r.environmental_noise, r.active_sensors,
+      r.burst_type, r.burst_intensity, r.burst_dismissed
+    ];
+    for (let s = 0; s < 3; s++) {
+      const summary = r.summary ? r.summary[s] : null;
+      row.push(
+        summary ? summary.min : null, summary ? summary.max : null,
+        summary ? summary.rms : null, summary ? summary.band_rms : null
+      );
+    }
+    row.push(r.heartbeat, r.timestamp);
+    return row;
+  });
+
+  insertReadings(rows, function (err) {
+    if (err) {
+      console.error('DB Insert Error:', err);
+      return res.status(500).json({ error: 'Database error' });
+    }
+    res.json({ success: true, count: records.length, id: this.lastID });
+  });
+});
+
+// POST /api/captures - raw waveform around a detection event (see waveform.js)
+app.post('/api/captures', express.raw({ type: 'application/octet-stream', limit: '64kb' }), (req, res) => {
+  let capture;
+  try {
+    capture = decodeWaveform(req.body);
+  } catch (err) {
+    return res.status(400).json({ error: err.message });
+  }
+
+  // Map the trigger onto the server clock through the device's send time, as
+  // for batches, and link the nearest confirmed reading. Without the header,
+  // assume the upload followed the last frame closely.
+  const sqliteTime = (ms) => new Date(ms).toISOString().replace('T', ' ').replace('Z', '');
+  const sentMs = deviceSentMs(req);
+  let triggerAt;
+  if (sentMs !== null) {
+    triggerAt = deviceTime(capture.triggerTimeMs, sentMs, new Date()).getTime();
+  } else {
+    const afterTriggerMs = ((capture.frameCount - 1 - capture.triggerFrame) * 1000) / capture.sampleRateHz;
+    triggerAt = Date.now() - afterTriggerMs;
+  }
+
+  db.get(
+    `SELECT id FROM sensor_data
+     WHERE leak_confirmed = 1 AND timestamp BETWEEN ? AND ?
+     ORDER BY ABS(julianday(timestamp) - julianday(?)) LIMIT 1`,
+    [sqliteTime(triggerAt - 5000), sqliteTime(triggerAt + 5000), sqliteTime(triggerAt)],
+    (err, event) => {
+      if (err) {
+        console.error('DB Query Error:', err);
+        return res.status(500).json({ error: 'Database error' });
+      }
+      db.run(
+        `INSERT INTO waveform_captures (
+          event_id, trigger_time_ms, sample_rate, sensor_count,
+          frame_count, trigger_frame, burst_type, data
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?)`,
+        [
+          event ? event.id : null, capture.triggerTimeMs, capture.sampleRateHz, capture.sensorCount,
+          capture.frameCount, capture.triggerFrame, capture.burstType, req.body
+        ],
+        function (err) {
+          if (err) {
+            console.error('DB Insert Error:', err);
+            return res.status(500).json({ error: 'Database error' });
+          }
+          res.json({ success: true, id: this.lastID, event_id: event ? event.id : null });
+        }
+      );
+    }
+  );
+});
+
+// GET /api/captures - metadata of the last 50 captures
+app.get('/api/captures', (req, res) => {
+  db.all(
+    `SELECT id, event_id, trigger_time_ms, sample_rate, sensor_count, frame_count,
+            trigger_frame, burst_type, length(data) AS bytes, created_at
+     FROM waveform_captures ORDER BY id DESC LIMIT 50`,
+    [],
+    (err, rows) => {
+      if (err) {
+        console.error('DB Query Error:', err);
+        return res.status(500).json({ error: 'Database error' });
+      }
+      res.json(rows);
+    }
+  );
+});
+
+// GET /api/captures/:id - decoded samples, or the stored frame with ?raw=1
+app.get('/api/captures/:id', (req, res) => {
+  db.get('SELECT * FROM waveform_captures WHERE id = ?', [parseInt(req.params.id, 10)], (err, row) => {
+    if (err) {
+      console.error('DB Query Error:', err);
+      return res.status(500).json({ error: 'Database error' });
+    }
+    if (!row) {
+      return res.status(404).json({ error: 'Capture not found' });
+    }
+    if (req.query.raw) {
+      return res.type('application/octet-stream').send(row.data);
+    }
+    const capture = decodeWaveform(row.data);
+    res.json({ id: row.id, event_id: row.event_id, created_at: row.created_at, ...capture });
+  });
+});
+
 // GET /api/data - get last 10 readings
 app.get('/api/data', (req, res) => {
   db.all(
@@ -217,6 +492,14 @@ app.get('/api/status', (req, res) => {
         burst_type: row.burst_type || 'NORMAL FLOW',
         burst_intensity: row.burst_intensity || 0,
         burst_dismissed: Boolean(row.burst_dismissed),
+        summary: row.sensor1_rms === null || row.sensor1_rms === undefined ? null : [1, 2, 3].map((n) => ({
+          min: row[`sensor${n}_min`],
+          max: row[`sensor${n}_max`],
+          rms: row[`sensor${n}_rms`],
+          band_rms: row[`sensor${n}_band`]
+        })),
+        // Unchanged since timestamp, unless the device stopped reporting
+        stale: !row.timestamp || Date.now() - sqliteMs(row.timestamp) > STALE_AFTER_MS,
         timestamp: isoTimestamp
       });
     }
@@ -233,8 +516,9 @@ app.get('/api/history', (req, res) => {
         console.error('DB Query Error:', err);
         return res.status(500).json({ error: 'Database error' });
       }
-      // Convert all timestamps to ISO 8601 (UTC)
-      const result = rows.reverse().map(item => ({
+      // Convert all timestamps to ISO 8601 (UTC); gaps between reports are
+      // unchanged, so each reading carries the time it holds until
+      const result = withHoldUntil(rows.reverse()).map(item => ({
         ...item,
         leak_confirmed: Boolean(item.leak_confirmed),
         burst_confirmed: Boolean(item.burst_confirmed),
@@ -250,15 +534,16 @@ app.get('/api/history', (req, res) => {
 // GET /api/sensors - get individual sensor data
 app.get('/api/sensors', (req, res) => {
   db.all(
-    'SELECT sensor1, sensor2, sensor3, timestamp FROM sensor_data ORDER BY id DESC LIMIT 50',
+    `SELECT sensor1, sensor2, sensor3, ${SUMMARY_COLUMNS.join(', ')}, timestamp
+     FROM sensor_data ORDER BY id DESC LIMIT 50`,
     [],
     (err, rows) => {
       if (err) {
         console.error('DB Query Error:', err);
         return res.status(500).json({ error: 'Database error' });
       }
-      // Convert all timestamps to ISO 8601 (UTC)
-      const result = rows.reverse().map(item => ({
+      // Convert all timestamps to ISO 8601 (UTC), with the hold time as in /api/history
+      const result = withHoldUntil(rows.reverse()).map(item => ({
         ...item,
         timestamp: item.timestamp ? new Date(item.timestamp + 'Z').toISOString() : null
       }));
@@ -277,12 +562,61 @@ app.post('/api/dismiss', (req, res) => {
         console.error('DB Update Error:', err);
         return res.status(500).json({ error: 'Database error' });
       }
+      commands.send(COMMAND.DISMISS_BURST);
       console.log('✅ Burst alert dismissed');
       res.json({ success: true, dismissed: true });
     }
   );
 });
 
+// GET /api/commands - device long-poll for pending commands (see commands.js)
+app.get('/api/commands', (req, res) => {
+  const device = String(req.query.device || '');
+  if (!/^[\w.-]{1,32}$/.test(device)) {
+    return res.status(400).json({ error: 'Invalid device id' });
+  }
+  const after = Math.max(0, parseInt(req.query.after, 10) || 0);
+  const wait = Math.min(Math.max(0, parseInt(req.query.wait, 10) || 0), MAX_WAIT_MS);
+
+  const pending = commands.poll(device, after, wait, (queued) => {
+    if (res.headersSent) return;
+    if (queued.length === 0) return res.status(204).end();
+    res.type('application/octet-stream').send(encodeCommands(queued));
+  });
+  res.on('close', () => pending.cancel());
+});
+
+// POST /api/commands - queue a command for one device or all of them
+app.post('/api/commands', (req, res) => {
+  const type = commandNames.get(req.body.type);
+  if (!type) {
+    return res.status(400).json({ error: 'Unknown command type' });
+  }
+  const argument = parseArgument(req.body.argument);
+  if (argument === null) {
+    return res.status(400).json({ error: 'Argument must be a 32-bit integer' });
+  }
+  const device = req.body.device === undefined ? null : String(req.body.device);
+  if (device !== null && !/^[\w.-]{1,32}$/.test(device)) {
+    return res.status(400).json({ error: 'Invalid device id' });
+  }
+  const sequence = commands.send(type, argument, device);
+  res.json({ success: true, sequence });
+});
+
+// GET /api/commands/stats - long-poll counters
+app.get('/api/commands/stats', (req, res) => {
+  res.json(commands.snapshot());
+});
+
+// GET /api/db/stats - where database calls spend their time, per SQL (?reset=1 starts a new window)
+app.get('/api/db/stats', (req, res) => {
+  if (typeof db.stats !== 'function') return res.status(501).json({ error: 'Not supported by this sqlite3 build' });
+  const stats = db.stats();
+  if (req.query.reset) db.resetStats();
+  res.json(stats);
+});
+
 // Serve frontend
 app.use(express.static(path.join(__dirname, '../frontend')));
 
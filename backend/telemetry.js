@@ -0,0 +1,180 @@
+// Decoder for the binary telemetry batches sent by the ESP32
+// (encoder and frame layout: dsp/telemetry_codec.h).
+
+// Version 2 adds per-sensor window summaries behind FLAG.SUMMARY
+const FORMAT_VERSION = 2;
+const HEADER_BYTES = 9;
+
+// Index = BurstTypeCode
+const burstTypes = ['NORMAL', 'NORMAL FLOW', 'PIPELINE LEAK', 'PIPELINE BURST', 'CATASTROPHIC BURST'];
+
+// Index = LocationKind
+const LOCATION = {
+  NONE: 0,
+  NO_ACTIVITY: 1,
+  ISOLATED: 2,
+  NEAR: 3,
+  BETWEEN: 4,
+  SEGMENT: 5,
+  EITHER_END: 6,
+  MULTIPLE: 7,
+  UNKNOWN: 8
+};
+
+const FLAG = {
+  LEAK: 1,
+  BURST: 2,
+  CATASTROPHIC: 4,
+  ENVIRONMENTAL_NOISE: 8,
+  DISMISSED: 16,
+  HEARTBEAT: 32,
+  SUMMARY: 64
+};
+
+// Section names the firmware used in its location text
+const sensorSections = ['Main Pipeline Section', 'Secondary Pipeline Section', 'Pipeline Junction Area'];
+
+function pairSection(a, b) {
+  const low = Math.min(a, b);
+  const high = Math.max(a, b);
+  if (low === 0 && high === 1) return 'Main Pipeline Section';
+  if (low === 1 && high === 2) return 'Secondary Pipeline Section';
+  if (low === 0 && high === 2) return 'Pipeline Junction Area';
+  return 'Pipeline Section';
+}
+
+function locationText(kind, a, b, positionDm, sensorCount) {
+  switch (kind) {
+    case LOCATION.NONE: return 'No leak detected';
+    case LOCATION.NO_ACTIVITY: return 'No activity detected';
+    case LOCATION.ISOLATED: return 'Isolated sensor activity - possible false positive';
+    case LOCATION.NEAR: return `Near Sensor ${a + 1} - ${sensorSections[a] || 'Pipeline Section'}`;
+    case LOCATION.BETWEEN: return `Between Sensor ${a + 1} and Sensor ${b + 1} - ${pairSection(a, b)}`;
+    case LOCATION.SEGMENT:
+      return `Between Sensor ${a + 1} and Sensor ${a + 2} - ${(positionDm / 10).toFixed(1)} m from Sensor ${a + 1}`;
+    case LOCATION.EITHER_END: return `Near Sensor 1 or Sensor ${sensorCount} - Pipeline Junction Area`;
+    case LOCATION.MULTIPLE: return 'Multiple sensors - Pipeline section affected';
+    default: return 'Unknown location';
+  }
+}
+
+class Reader {
+  constructor(buffer) {
+    this.buffer = buffer;
+    this.offset = 0;
+  }
+
+  byte() {
+    if (this.offset >= this.buffer.length) throw new Error('Truncated telemetry frame');
+    return this.buffer[this.offset++];
+  }
+
+  varint() {
+    let value = 0;
+    for (let shift = 0; shift < 35; shift += 7) {
+      const b = this.byte();
+      value += (b & 0x7f) * 2 ** shift;
+      if (b < 0x80) return value;
+    }
+    throw new Error('Malformed varint in telemetry frame');
+  }
+
+  zigzag() {
+    const value = this.varint();
+    return value % 2 === 0 ? value / 2 : -(value + 1) / 2;
+  }
+}
+
+// Maps a device millis() time onto the server clock, given the device's
+// millis() when it sent the request (`sentMs`) and when the request arrived.
+// Differences are taken mod 2^32, so the 49-day millis() wrap is harmless.
+function deviceTime(timeMs, sentMs, receivedAt) {
+  return new Date(receivedAt.getTime() - ((sentMs - timeMs) >>> 0));
+}
+
+// Decodes one frame into rows shaped like the JSON /api/data body, plus a
+// `timestamp` in SQLite DATETIME format and, for window summaries, `summary`
+// with {min, max, rms, band_rms} per sensor (null otherwise). Device times are mapped onto the
+// server clock through the device's send time `sentMs`, so batches replayed
+// from the spool keep the times they were measured at. Without it (older
+// firmware) the last record is taken as received at `receivedAt`.
+function decodeBatch(buffer, receivedAt = new Date(), sentMs = null) {
+  if (!Buffer.isBuffer(buffer) || buffer.length < HEADER_BYTES) {
+    throw new Error('Telemetry frame too short');
+  }
+  if (buffer[0] !== 0x4c || buffer[1] !== 0x54) throw new Error('Not a telemetry frame');
+  const version = buffer[2];
+  if (version < 1 || version > FORMAT_VERSION) throw new Error(`Unsupported telemetry version ${version}`);
+
+  const sensorCount = buffer[3];
+  const recordCount = buffer[4];
+  const reader = new Reader(buffer);
+  reader.offset = HEADER_BYTES;
+
+  let timeMs = buffer.readUInt32LE(5);
+  const values = new Array(sensorCount).fill(0);
+  const records = [];
+
+  for (let i = 0; i < recordCount; i++) {
+    timeMs += reader.varint();
+    const flags = reader.byte();
+    const burstCode = reader.byte();
+    const kind = reader.byte();
+    let a = 0;
+    let b = 0;
+    let positionDm = 0;
+    if (kind === LOCATION.NEAR) {
+      a = reader.byte();
+    } else if (kind === LOCATION.BETWEEN) {
+      a = reader.byte();
+      b = reader.byte();
+    } else if (kind === LOCATION.SEGMENT) {
+      a = reader.byte();
+      positionDm = reader.varint();
+    }
+    const confidence = reader.varint() / 10;
+    const correlationScore = reader.varint();
+    const stabilityScore = reader.varint();
+    const activeSensors = reader.varint();
+    const burstIntensity = reader.varint() / 10;
+    for (let s = 0; s < sensorCount; s++) values[s] += reader.zigzag();
+    let summary = null;
+    if (version >= 2 && flags & FLAG.SUMMARY) {
+      summary = [];
+      for (let s = 0; s < sensorCount; s++) {
+        const min = values[s] - reader.zigzag();
+        const max = values[s] + reader.zigzag();
+        summary.push({ min, max, rms: reader.varint(), band_rms: reader.varint() });
+      }
+    }
+
+    records.push({
+      timeMs,
+      sensors: values.slice(),
+      leak_confirmed: flags & FLAG.LEAK ? 1 : 0,
+      burst_confirmed: flags & FLAG.BURST ? 1 : 0,
+      leak_location: locationText(kind, a, b, positionDm, sensorCount),
+      confidence,
+      correlation_score: correlationScore,
+      stability_score: stabilityScore,
+      environmental_noise: flags & FLAG.ENVIRONMENTAL_NOISE ? 1 : 0,
+      active_sensors: activeSensors,
+      burst_type: burstTypes[burstCode] || 'NORMAL FLOW',
+      burst_intensity: burstIntensity,
+      burst_dismissed: flags & FLAG.DISMISSED ? 1 : 0,
+      heartbeat: flags & FLAG.HEARTBEAT ? 1 : 0,
+      summary
+    });
+  }
+  if (reader.offset !== buffer.length) throw new Error('Trailing bytes after telemetry frame');
+
+  if (sentMs === null) sentMs = records.length ? records[records.length - 1].timeMs : 0;
+  for (const record of records) {
+    const at = deviceTime(record.timeMs, sentMs, receivedAt);
+    // Same layout as CURRENT_TIMESTAMP, with milliseconds
+    record.timestamp = at.toISOString().replace('T', ' ').replace('Z', '');
+  }
+  return records;
+}
+
+module.exports = { decodeBatch, deviceTime, burstTypes, LOCATION, FLAG };
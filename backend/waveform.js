@@ -0,0 +1,92 @@
+// Decoder for the raw waveform captures the ESP32 uploads on detection events
+// (encoder and frame layout: dsp/waveform_capture.h).
+
+const { burstTypes } = require('./telemetry');
+
+const FORMAT_VERSION = 1;
+const HEADER_BYTES = 15;
+const BLOCK = 32;
+const ESCAPE = 16;
+const ESCAPE_BITS = 17;
+
+// Most significant bit first, like the firmware's BitWriter
+class BitReader {
+  constructor(buffer, offset) {
+    this.buffer = buffer;
+    this.offset = offset;
+    this.bit = 0;
+  }
+
+  read(count) {
+    let value = 0;
+    for (let i = 0; i < count; i++) {
+      if (this.offset >= this.buffer.length) throw new Error('Truncated waveform capture');
+      value = value * 2 + ((this.buffer[this.offset] >> (7 - this.bit)) & 1);
+      if (++this.bit === 8) {
+        this.bit = 0;
+        this.offset++;
+      }
+    }
+    return value;
+  }
+
+  // Rice-coded value with parameter k, or the escape form
+  rice(k) {
+    let quotient = 0;
+    while (quotient < ESCAPE && this.read(1) === 1) quotient++;
+    if (quotient === ESCAPE) return this.read(ESCAPE_BITS);
+    return quotient * 2 ** k + this.read(k);
+  }
+
+  // Bytes consumed, counting a partly read byte
+  end() {
+    return this.offset + (this.bit > 0 ? 1 : 0);
+  }
+}
+
+function header(buffer) {
+  if (!Buffer.isBuffer(buffer) || buffer.length < HEADER_BYTES) {
+    throw new Error('Waveform capture too short');
+  }
+  if (buffer[0] !== 0x4c || buffer[1] !== 0x57) throw new Error('Not a waveform capture');
+  if (buffer[2] !== FORMAT_VERSION) throw new Error(`Unsupported waveform version ${buffer[2]}`);
+  const frameCount = buffer.readUInt16LE(6);
+  const triggerFrame = buffer.readUInt16LE(8);
+  if (frameCount === 0 || triggerFrame >= frameCount) throw new Error('Invalid waveform trigger frame');
+  return {
+    sensorCount: buffer[3],
+    sampleRateHz: buffer.readUInt16LE(4),
+    frameCount,
+    triggerFrame,
+    triggerTimeMs: buffer.readUInt32LE(10),
+    burstType: burstTypes[buffer[14]] || 'NORMAL FLOW'
+  };
+}
+
+// Decodes one capture into its header fields plus `samples`, one array of
+// raw ADC counts per sensor. samples[s][triggerFrame] is the sample at which
+// the detector confirmed the event.
+function decodeWaveform(buffer) {
+  const capture = header(buffer);
+  const reader = new BitReader(buffer, HEADER_BYTES);
+  capture.samples = [];
+  for (let s = 0; s < capture.sensorCount; s++) {
+    const first = reader.read(16);
+    const samples = [first >= 0x8000 ? first - 0x10000 : first];
+    let value = samples[0];
+    for (let start = 1; start < capture.frameCount; start += BLOCK) {
+      const length = Math.min(BLOCK, capture.frameCount - start);
+      const k = reader.read(4);
+      for (let i = 0; i < length; i++) {
+        const v = reader.rice(k);
+        value += v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+        samples.push(value);
+      }
+    }
+    capture.samples.push(samples);
+  }
+  if (reader.end() !== buffer.length) throw new Error('Trailing bytes after waveform capture');
+  return capture;
+}
+
+module.exports = { decodeWaveform, header, FORMAT_VERSION };
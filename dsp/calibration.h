@@ -0,0 +1,203 @@
+#ifndef LEAKDSP_CALIBRATION_H
+#define LEAKDSP_CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "detector_config.h"
+#include "leak_detector.h"
+
+// Calibration snapshot for a warm start after reset.
+//
+// The noise baselines the detector learns (boot calibration, then quiet
+// periods) are checkpointed periodically to non-volatile storage as a small
+// versioned record. On boot the firmware restores it instead of sampling
+// calibrationSamples frames first, so detection runs from the first frame and
+// the baselines keep refining in the background as before.
+//
+// Record (version 1, multi-byte integers little-endian):
+//   'L' 'B'  version  sensorCount  noiseWindow (uint16)
+// then per sensor:
+//   uint16  noise mean x16
+//   uint32  noise variance x16
+//   uint16  leak, burst and catastrophic thresholds at the checkpoint
+// then:
+//   uint16  CRC-16/CCITT of everything before it
+//
+// Records from a build with another sensor count or noise window are
+// rejected, so a changed configuration falls back to a cold calibration.
+
+namespace leakdsp {
+
+const uint8_t calibrationFormatVersion = 1;
+const int calibrationHeaderBytes = 6;
+const int calibrationSensorBytes = 12;
+const uint32_t calibrationCheckpointMs = 10 * 60 * 1000UL;  // flash wear: ~150 writes a day at most
+
+inline int calibrationRecordBytes(int sensors) { return calibrationHeaderBytes + sensors * calibrationSensorBytes + 2; }
+
+// Non-volatile home of one calibration record (NVS on the board, a file on
+// the host).
+class CalibrationStore {
+public:
+  virtual ~CalibrationStore() {}
+  // Copies the stored record into data; false when none is stored or it does not fit.
+  virtual bool load(uint8_t* data, size_t capacity, size_t* size) = 0;
+  // Replaces the stored record; must not leave a torn record behind.
+  virtual bool save(const uint8_t* data, size_t size) = 0;
+};
+
+template <int S>
+struct BasicCalibrationSnapshot {
+  int32_t noiseMeanQ4[S];
+  uint32_t noiseVarianceQ4[S];
+  Thresholds thresholds[S];
+};
+
+typedef BasicCalibrationSnapshot<numSensors> CalibrationSnapshot;
+
+inline uint8_t* putLe(uint8_t* out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) *out++ = (uint8_t)(value >> (8 * i));
+  return out;
+}
+
+inline uint32_t getLe(const uint8_t* in, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+inline uint16_t clampU16(int32_t value) { return (uint16_t)(value < 0 ? 0 : (value > 0xFFFF ? 0xFFFF : value)); }
+
+inline uint16_t crc16Ccitt(const uint8_t* data, size_t size) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+template <typename Detector>
+void captureCalibration(const Detector& detector, BasicCalibrationSnapshot<Detector::sensorCount>& snapshot) {
+  for (int s = 0; s < Detector::sensorCount; s++) {
+    snapshot.noiseMeanQ4[s] = detector.noiseWindowOf(s).meanQ4();
+    snapshot.noiseVarianceQ4[s] = detector.noiseWindowOf(s).varianceQ4();
+    snapshot.thresholds[s] = detector.thresholds(s);
+  }
+}
+
+template <typename Detector>
+void restoreCalibration(Detector& detector, const BasicCalibrationSnapshot<Detector::sensorCount>& snapshot) {
+  for (int s = 0; s < Detector::sensorCount; s++) {
+    detector.restoreNoiseBaseline(s, snapshot.noiseMeanQ4[s], snapshot.noiseVarianceQ4[s]);
+  }
+}
+
+// Writes calibrationRecordBytes(S) bytes to out.
+template <int S>
+size_t encodeCalibration(const BasicCalibrationSnapshot<S>& snapshot, uint8_t* out) {
+  uint8_t* p = out;
+  *p++ = 'L';
+  *p++ = 'B';
+  *p++ = calibrationFormatVersion;
+  *p++ = (uint8_t)S;
+  p = putLe(p, (uint32_t)noiseWindow, 2);
+  for (int s = 0; s < S; s++) {
+    p = putLe(p, (uint32_t)clampU16(snapshot.noiseMeanQ4[s]), 2);
+    p = putLe(p, snapshot.noiseVarianceQ4[s], 4);
+    p = putLe(p, (uint32_t)clampU16(snapshot.thresholds[s].leak), 2);
+    p = putLe(p, (uint32_t)clampU16(snapshot.thresholds[s].burst), 2);
+    p = putLe(p, (uint32_t)clampU16(snapshot.thresholds[s].catastrophic), 2);
+  }
+  p = putLe(p, crc16Ccitt(out, (size_t)(p - out)), 2);
+  return (size_t)(p - out);
+}
+
+// False for a truncated, corrupt or foreign record.
+template <int S>
+bool decodeCalibration(const uint8_t* data, size_t size, BasicCalibrationSnapshot<S>& snapshot) {
+  if (size != (size_t)calibrationRecordBytes(S)) return false;
+  if (data[0] != 'L' || data[1] != 'B' || data[2] != calibrationFormatVersion || data[3] != S) return false;
+  if (getLe(data + 4, 2) != (uint32_t)noiseWindow) return false;
+  if (getLe(data + size - 2, 2) != crc16Ccitt(data, size - 2)) return false;
+  const uint8_t* p = data + calibrationHeaderBytes;
+  for (int s = 0; s < S; s++) {
+    snapshot.noiseMeanQ4[s] = (int32_t)getLe(p, 2);
+    snapshot.noiseVarianceQ4[s] = getLe(p + 2, 4);
+    snapshot.thresholds[s].leak = (int)getLe(p + 6, 2);
+    snapshot.thresholds[s].burst = (int)getLe(p + 8, 2);
+    snapshot.thresholds[s].catastrophic = (int)getLe(p + 10, 2);
+    p += calibrationSensorBytes;
+  }
+  return true;
+}
+
+// Restores the detector from a store at boot and checkpoints it back while
+// running. poll() is cheap when nothing is due, so it can sit in the
+// analysis loop.
+template <typename Detector>
+class CalibrationCheckpoint {
+public:
+  typedef BasicCalibrationSnapshot<Detector::sensorCount> Snapshot;
+  static const int recordBytes = calibrationHeaderBytes + Detector::sensorCount * calibrationSensorBytes + 2;
+
+  explicit CalibrationCheckpoint(CalibrationStore& store, uint32_t intervalMs = calibrationCheckpointMs)
+      : store_(store), intervalMs_(intervalMs), lastMs_(0), started_(false), lastSize_(0), saves_(0) {}
+
+  // Loads the stored record into detector. False when there is none usable;
+  // the caller then runs the cold boot calibration.
+  bool restore(Detector& detector, Snapshot* restored = 0) {
+    size_t size = 0;
+    Snapshot snapshot;
+    if (!store_.load(last_, sizeof(last_), &size) || !decodeCalibration(last_, size, snapshot)) return false;
+    lastSize_ = size;
+    restoreCalibration(detector, snapshot);
+    if (restored) *restored = snapshot;
+    return true;
+  }
+
+  // Saves a checkpoint every intervalMs, skipping it while an alarm is
+  // confirmed (the baseline then only reflects the quiet periods before it)
+  // and when the record would not change. Returns true when it saved.
+  bool poll(const Detector& detector, uint32_t nowMs) {
+    if (!started_) {
+      started_ = true;
+      lastMs_ = nowMs;
+      return false;
+    }
+    if (nowMs - lastMs_ < intervalMs_ || detector.decision().leakConfirmed) return false;
+    lastMs_ = nowMs;
+    return save(detector);
+  }
+
+  // Saves immediately (first checkpoint after a cold calibration).
+  bool save(const Detector& detector) {
+    Snapshot snapshot;
+    captureCalibration(detector, snapshot);
+    uint8_t record[recordBytes];
+    size_t size = encodeCalibration(snapshot, record);
+    if (size == lastSize_ && memcmp(record, last_, size) == 0) return false;
+    if (!store_.save(record, size)) return false;
+    memcpy(last_, record, size);
+    lastSize_ = size;
+    saves_++;
+    return true;
+  }
+
+  uint32_t saves() const { return saves_; }
+
+private:
+  CalibrationStore& store_;
+  uint32_t intervalMs_;
+  uint32_t lastMs_;
+  bool started_;
+  uint8_t last_[recordBytes];
+  size_t lastSize_;
+  uint32_t saves_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_CALIBRATION_H
@@ -0,0 +1,108 @@
+#ifndef LEAKDSP_COMMAND_CODEC_H
+#define LEAKDSP_COMMAND_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Downstream command frame, encoded by backend/commands.js and delivered as
+// the body of a GET /api/commands long-poll.
+//
+// Frame (version 1, multi-byte integers little-endian):
+//   'L' 'C'  version  commandCount
+// then commandCount commands of:
+//   uint32  sequence (increasing; the device echoes the last one as `after`)
+//   byte    type (CommandType)
+//   int32   argument (type specific, 0 when unused)
+
+namespace leakdsp {
+
+const uint8_t commandFormatVersion = 1;
+const int commandHeaderBytes = 4;
+const int commandBytes = 9;
+const int commandBatchMax = 16;  // backend keeps at most this many per device
+const int commandFrameMaxBytes = commandHeaderBytes + commandBatchMax * commandBytes;
+
+// Must match COMMAND in backend/commands.js.
+enum CommandType {
+  CommandNone,
+  CommandDismissBurst,   // silence the current burst alarm
+  CommandClearDismiss,   // re-arm the alarm without waiting for a new burst
+  CommandPing,           // no-op, for latency measurement
+  CommandTypeCount
+};
+
+struct Command {
+  uint32_t sequence;
+  uint8_t type;
+  int32_t argument;
+};
+
+// Decodes a frame byte by byte, so the body can be read in any chunk size
+// straight from the socket. No heap use.
+class CommandParser {
+public:
+  CommandParser() { reset(); }
+
+  void reset() {
+    offset_ = 0;
+    remaining_ = -1;
+    error_ = false;
+  }
+
+  // Consumes one byte. Returns true when it completed a command, which is
+  // then available from command() until the next call.
+  bool feed(uint8_t byte) {
+    if (error_ || remaining_ == 0) {
+      error_ = true;  // bytes after the last command
+      return false;
+    }
+    buffer_[offset_++] = byte;
+
+    if (remaining_ < 0) {
+      if (offset_ < commandHeaderBytes) return false;
+      if (buffer_[0] != 'L' || buffer_[1] != 'C' || buffer_[2] != commandFormatVersion) {
+        error_ = true;
+        return false;
+      }
+      remaining_ = buffer_[3];
+      offset_ = 0;
+      return false;
+    }
+
+    if (offset_ < commandBytes) return false;
+    command_.sequence = readLe32(buffer_);
+    command_.type = buffer_[4];
+    command_.argument = (int32_t)readLe32(buffer_ + 5);
+    offset_ = 0;
+    remaining_--;
+    return true;
+  }
+
+  // Feeds a whole chunk, calling handler(command, context) per command.
+  // Returns false once the frame is malformed.
+  bool feed(const uint8_t* data, size_t size, void (*handler)(const Command&, void*), void* context) {
+    for (size_t i = 0; i < size; i++) {
+      if (feed(data[i])) handler(command_, context);
+    }
+    return !error_;
+  }
+
+  const Command& command() const { return command_; }
+  bool error() const { return error_; }
+  bool complete() const { return !error_ && remaining_ == 0; }
+
+private:
+  static uint32_t readLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+  }
+
+  uint8_t buffer_[commandBytes];
+  int offset_;
+  int remaining_;  // commands still expected, -1 while reading the header
+  bool error_;
+  Command command_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_COMMAND_CODEC_H
@@ -0,0 +1,80 @@
+#ifndef LEAKDSP_DETECTOR_CONFIG_H
+#define LEAKDSP_DETECTOR_CONFIG_H
+
+// Detection parameters shared by the firmware and the host replay build.
+
+#include "sample_traits.h"
+
+namespace leakdsp {
+
+const int numSensors = 3;  // piezos on the firmware build; the detector template takes any count
+
+// 🏗️ REAL-WORLD MUNICIPAL PIPELINE BURST DETECTION PARAMETERS
+// Based on research: Underground pipeline bursts generate 50-200+ Hz vibrations
+// with amplitudes typically 10-100x higher than normal flow conditions
+
+// REALISTIC THRESHOLDS FOR MUNICIPAL PIPELINE BURSTS
+const int normalFlowThreshold = 15;        // Normal water flow vibration (15-30 range)
+const int leakThreshold = 45;              // Small leak detection (45-80 range)
+const int burstThreshold = 120;            // Pipeline burst detection (120-300+ range)
+const int catastrophicBurstThreshold = 250; // Major burst/pipe rupture (250+ range)
+
+// 🔥 ADVANCED FILTERING FOR REAL-WORLD CONDITIONS
+// Windows and debounces are lengths of time, as tuned on the original ~15 ms
+// sampling loop, and are counted in frames of the fixed acquisition rate.
+const int sampleRateHz = 200;              // Fixed acquisition rate (5 ms per frame)
+constexpr int framesIn(int ms) { return ms * sampleRateHz / 1000; }
+
+const int signalWindowMs = 750;            // Larger window for burst pattern analysis
+const int noiseWindowMs = 2250;            // Extended noise baseline for urban environments
+const int requiredConsecutiveMs = 90;      // Faster response for burst detection
+const int catastrophicConsecutiveMs = 60;  // Major bursts confirm sooner still
+const int signalWindow = framesIn(signalWindowMs);                          // 150 frames
+const int noiseWindow = framesIn(noiseWindowMs);                            // 450 frames
+const int requiredConsecutive = framesIn(requiredConsecutiveMs);            // 18 frames
+const int catastrophicConsecutive = framesIn(catastrophicConsecutiveMs);    // 12 frames
+constexpr float adaptiveMultiplier = 2.5;  // Conservative threshold for urban noise
+const int minLeakDuration = 300;           // Shorter duration for burst response
+const int burstResponseTime = 150;         // Very fast burst response (150ms)
+
+// 🎯 PRECISION FILTERS FOR MUNICIPAL ENVIRONMENT
+constexpr float sensorAgreementThreshold = 0.5;  // 50% sensor agreement (urban noise)
+const int vibrationCooldown = 1500;          // 1.5-second cooldown after high vibration
+constexpr float signalStabilityThreshold = 0.25; // Higher variance tolerance for bursts
+const int patternConsistency = 3;            // Pattern must be consistent across readings
+
+// 🔍 BURST SIGNATURE DETECTION (Real-world pipeline burst frequencies)
+const float burstFreqMin = 20.0;        // Min frequency for burst (20-60 Hz typical)
+const float burstFreqMax = 80.0;        // Max frequency for burst (60-120 Hz possible)
+constexpr float amplitudeConsistency = 0.4; // Amplitude variation tolerance for bursts
+const float burstAmplitudeSpike = 2.5;  // Burst causes 2.5x amplitude spike
+
+// The same limits as compile-time Ratio constants for the fixed-point path
+constexpr Ratio leakSigma = ratio(adaptiveMultiplier);      // noise stddevs above the baseline
+constexpr Ratio burstSigma = ratio(4.0);
+constexpr Ratio catastrophicSigma = ratio(6.0);
+constexpr Ratio agreementLimit = ratio(sensorAgreementThreshold);
+constexpr Ratio stabilityLimit = ratio(signalStabilityThreshold);
+constexpr Ratio amplitudeLimit = ratio(amplitudeConsistency);
+constexpr Ratio spikeRatioLimit = ratio(3.0);   // 300% sudden change indicates environmental noise
+constexpr Ratio noiseRatioLimit = ratio(15.0);  // Signal 15x above baseline = likely noise
+constexpr Ratio locationLimit = ratio(0.3);     // strongest pair correlation to locate a leak
+
+// 📈 SPECTRAL BAND CHECK (Goertzel bank over each signalWindow block)
+const int referenceBandBins = 4;        // Reference bins below and above the burst band
+const float burstBandRatioMin = 2.0;    // Burst band must carry 2x the reference power
+const int burstBandRatioQ8 = (int)(burstBandRatioMin * 256);
+const int sampleRateTolerancePct = 20;  // Skip the check when frames drift off sampleRateHz
+
+// 📍 LEAK LOCALIZATION (time difference of arrival between adjacent sensors)
+const float sensorSpacingM = 10.0;      // Pipe length between adjacent sensors
+const float waveSpeedMps = 1200.0;      // Leak noise propagation speed in a water-filled main
+const int maxLagSamples = 8;            // Cross-correlation lag search range (±)
+
+// Boot calibration of the noise baselines
+const int calibrationSamples = 600;     // 15 seconds at 25ms per sample
+const int calibrationIntervalMs = 25;
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_DETECTOR_CONFIG_H
@@ -0,0 +1,76 @@
+#ifndef LEAKDSP_FFT_H
+#define LEAKDSP_FFT_H
+
+#include <math.h>
+
+// In-place iterative radix-2 complex FFT on split real/imaginary arrays.
+// Twiddles are tabulated once per instance, so a transform makes no libm
+// calls. N must be a power of two.
+
+namespace leakdsp {
+
+template <int N>
+class Fft {
+public:
+  Fft() {
+    for (int k = 0; k < N / 2; k++) {
+      float w = -2.0f * 3.14159265f * k / N;
+      cos_[k] = cosf(w);
+      sin_[k] = sinf(w);
+    }
+    for (int i = 0, j = 0; i < N; i++) {
+      reverse_[i] = j;
+      int bit = N >> 1;
+      while (j & bit) {
+        j ^= bit;
+        bit >>= 1;
+      }
+      j |= bit;
+    }
+  }
+
+  static int size() { return N; }
+
+  void forward(float* re, float* im) const { transform(re, im, 1.0f); }
+
+  // Unscaled inverse; divide by N for the true inverse.
+  void inverse(float* re, float* im) const { transform(re, im, -1.0f); }
+
+private:
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Fft size must be a power of two");
+
+  void transform(float* re, float* im, float direction) const {
+    for (int i = 0; i < N; i++) {
+      int j = reverse_[i];
+      if (j > i) {
+        float t = re[i]; re[i] = re[j]; re[j] = t;
+        t = im[i]; im[i] = im[j]; im[j] = t;
+      }
+    }
+    for (int half = 1; half < N; half <<= 1) {
+      int stride = N / (2 * half);
+      for (int start = 0; start < N; start += 2 * half) {
+        for (int k = 0; k < half; k++) {
+          float wr = cos_[k * stride];
+          float wi = direction * sin_[k * stride];
+          int a = start + k;
+          int b = a + half;
+          float tr = re[b] * wr - im[b] * wi;
+          float ti = re[b] * wi + im[b] * wr;
+          re[b] = re[a] - tr;
+          im[b] = im[a] - ti;
+          re[a] += tr;
+          im[a] += ti;
+        }
+      }
+    }
+  }
+
+  float cos_[N / 2];
+  float sin_[N / 2];
+  int reverse_[N];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_FFT_H
@@ -0,0 +1,47 @@
+#ifndef LEAKDSP_FILE_CALIBRATION_STORE_H
+#define LEAKDSP_FILE_CALIBRATION_STORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "calibration.h"
+
+// Calibration record in a single stdio file. save() writes a sibling
+// "<path>.tmp" and renames it over the record, so a reset during the write
+// leaves the previous record intact. Used by the host harness; the board
+// keeps the record in NVS.
+
+namespace leakdsp {
+
+class FileCalibrationStore : public CalibrationStore {
+public:
+  explicit FileCalibrationStore(const char* path) : path_(path) {}
+
+  bool load(uint8_t* data, size_t capacity, size_t* size) {
+    FILE* file = fopen(path_, "rb");
+    if (!file) return false;
+    *size = fread(data, 1, capacity, file);
+    bool complete = fgetc(file) == EOF;  // larger than capacity otherwise
+    fclose(file);
+    return complete && *size > 0;
+  }
+
+  bool save(const uint8_t* data, size_t size) {
+    char temporary[256];
+    if (strlen(path_) + 5 > sizeof(temporary)) return false;
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path_);
+    FILE* file = fopen(temporary, "wb");
+    if (!file) return false;
+    bool written = fwrite(data, 1, size, file) == size && fflush(file) == 0;
+    fclose(file);
+    return written && rename(temporary, path_) == 0;
+  }
+
+private:
+  const char* path_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_FILE_CALIBRATION_STORE_H
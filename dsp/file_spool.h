@@ -0,0 +1,187 @@
+#ifndef LEAKDSP_FILE_SPOOL_H
+#define LEAKDSP_FILE_SPOOL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "transmit.h"
+
+// Spool in a single stdio file: a 4-byte head offset, then records of a
+// 2-byte length and the batch bytes. popFront() only advances the head, and
+// writes it back every headSyncRecords records rather than once per record
+// (one flash write each on LittleFS), so a reboot may replay up to that many
+// batches again. Only the records behind the head count against the
+// capacity: once the head passes half the file, or an append would run past
+// the capacity, the live records are rewritten into a fresh file that
+// replaces the old one. The file is truncated once everything has been
+// replayed. On the ESP32 the path lives on the LittleFS VFS mount (e.g.
+// "/littlefs/telemetry.spool"), on the host in the working directory.
+// Records survive a reboot.
+
+namespace leakdsp {
+
+class FileSpool : public Spool {
+public:
+  FileSpool(const char* path, uint32_t capacityBytes)
+      : path_(path), capacity_(capacityBytes), file_(0), head_(headerBytes), end_(headerBytes), count_(0),
+        unsynced_(0) {
+    snprintf(compactPath_, sizeof(compactPath_), "%s.tmp", path);
+  }
+
+  ~FileSpool() {
+    if (file_) fclose(file_);
+  }
+
+  // Opens or creates the file and counts the records left from last time.
+  bool open() {
+    remove(compactPath_);  // left by a compaction cut short
+    file_ = fopen(path_, "r+b");
+    if (!file_) return reset();
+
+    uint8_t header[headerBytes];
+    if (fread(header, 1, headerBytes, file_) != headerBytes || fseek(file_, 0, SEEK_END) != 0) return reset();
+    end_ = (uint32_t)ftell(file_);
+    head_ = readLe32(header);
+    if (head_ < headerBytes || head_ > end_) return reset();
+
+    count_ = 0;
+    uint32_t offset = head_;
+    while (offset < end_) {
+      uint8_t length[2];
+      if (fseek(file_, offset, SEEK_SET) != 0 || fread(length, 1, 2, file_) != 2) break;
+      uint32_t next = offset + 2 + (length[0] | (length[1] << 8));
+      if (next > end_) break;  // torn final write
+      offset = next;
+      count_++;
+    }
+    end_ = offset;
+    if (count_ == 0) return reset();
+    return true;
+  }
+
+  bool append(const uint8_t* data, size_t size) {
+    if (!file_ || !canAppend(size)) return false;
+    if (end_ + 2 + size > capacity_ && !compact()) return false;
+    uint8_t length[2] = {(uint8_t)size, (uint8_t)(size >> 8)};
+    if (fseek(file_, end_, SEEK_SET) != 0 || fwrite(length, 1, 2, file_) != 2 ||
+        fwrite(data, 1, size, file_) != size || fflush(file_) != 0) {
+      return false;
+    }
+    end_ += 2 + (uint32_t)size;
+    count_++;
+    return true;
+  }
+
+  bool front(uint8_t* data, size_t capacity, size_t* size) {
+    if (!file_ || count_ == 0) return false;
+    uint8_t length[2];
+    if (fseek(file_, head_, SEEK_SET) != 0 || fread(length, 1, 2, file_) != 2) return false;
+    *size = length[0] | (length[1] << 8);
+    return *size <= capacity && fread(data, 1, *size, file_) == *size;
+  }
+
+  void popFront() {
+    if (!file_ || count_ == 0) return;
+    uint8_t length[2];
+    if (fseek(file_, head_, SEEK_SET) != 0 || fread(length, 1, 2, file_) != 2) {
+      reset();
+      return;
+    }
+    head_ += 2 + (length[0] | (length[1] << 8));
+    if (--count_ == 0) {
+      reset();
+      return;
+    }
+    if (head_ - headerBytes >= (capacity_ - headerBytes) / 2) {
+      compact();
+    } else if (++unsynced_ >= headSyncRecords) {
+      writeHead();
+    }
+  }
+
+  uint32_t count() const { return count_; }
+  bool canAppend(size_t size) const { return headerBytes + (end_ - head_) + 2 + size <= capacity_; }
+
+private:
+  static const uint32_t headerBytes = 4;
+  static const uint32_t headSyncRecords = 16;
+
+  void writeHead() {
+    uint8_t header[headerBytes];
+    writeLe32(header, head_);
+    if (fseek(file_, 0, SEEK_SET) == 0 && fwrite(header, 1, headerBytes, file_) == headerBytes) {
+      fflush(file_);
+    }
+    unsynced_ = 0;
+  }
+
+  // Copies the records from the head on into a fresh file and renames it over
+  // the spool, so a reset during compaction leaves the old file intact.
+  bool compact() {
+    FILE* out = fopen(compactPath_, "wb");
+    if (!out) return false;
+    uint8_t chunk[256];
+    writeLe32(chunk, headerBytes);
+    bool ok = fwrite(chunk, 1, headerBytes, out) == headerBytes && fseek(file_, head_, SEEK_SET) == 0;
+    for (uint32_t left = end_ - head_; ok && left > 0;) {
+      size_t n = left < sizeof(chunk) ? left : sizeof(chunk);
+      ok = fread(chunk, 1, n, file_) == n && fwrite(chunk, 1, n, out) == n;
+      left -= (uint32_t)n;
+    }
+    ok = fflush(out) == 0 && ok;
+    fclose(out);
+    if (!ok) {
+      remove(compactPath_);
+      return false;
+    }
+
+    fclose(file_);
+    file_ = 0;
+    if (rename(compactPath_, path_) != 0) {
+      remove(compactPath_);
+      return open();
+    }
+    end_ = headerBytes + (end_ - head_);
+    head_ = headerBytes;
+    unsynced_ = 0;
+    file_ = fopen(path_, "r+b");
+    return file_ != 0;
+  }
+
+  // Empty spool: truncate and write a fresh header.
+  bool reset() {
+    if (file_) fclose(file_);
+    file_ = fopen(path_, "w+b");
+    head_ = end_ = headerBytes;
+    count_ = 0;
+    unsynced_ = 0;
+    if (!file_) return false;
+    uint8_t header[headerBytes];
+    writeLe32(header, head_);
+    return fwrite(header, 1, headerBytes, file_) == headerBytes && fflush(file_) == 0;
+  }
+
+  static uint32_t readLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+  }
+
+  static void writeLe32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+  }
+
+  const char* path_;
+  uint32_t capacity_;
+  FILE* file_;
+  uint32_t head_;
+  uint32_t end_;
+  uint32_t count_;
+  uint32_t unsynced_;  // records popped since the head was last written
+  char compactPath_[96];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_FILE_SPOOL_H
@@ -0,0 +1,141 @@
+#ifndef LEAKDSP_GOERTZEL_H
+#define LEAKDSP_GOERTZEL_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "detector_config.h"
+#include "rolling_stats.h"
+
+// Fixed-point Goertzel filter bank for per-window band energy.
+//
+// Coefficients are 2*cos(w) in Q14 and the filter state is int32, so a window
+// costs one 32x32->64 multiply per sample per bin and no libm calls. The
+// coefficients are computed once at startup.
+
+namespace leakdsp {
+
+const int goertzelShift = 14;
+
+template <int MaxBins>
+class GoertzelBank {
+public:
+  GoertzelBank() : bins_(0) {}
+
+  // Adds a bin at frequencyHz. Returns false when the bank is full.
+  bool addBin(float frequencyHz, float sampleRateHz) {
+    if (bins_ >= MaxBins) return false;
+    float w = 2.0f * 3.14159265f * frequencyHz / sampleRateHz;
+    coeff_[bins_] = (int32_t)lroundf(2.0f * cosf(w) * (1 << goertzelShift));
+    frequencyHz_[bins_] = frequencyHz;
+    bins_++;
+    return true;
+  }
+
+  int bins() const { return bins_; }
+  float frequency(int bin) const { return frequencyHz_[bin]; }
+
+  // Runs every bin over the window in chronological order with the dc level
+  // removed, writing one power value per bin.
+  // Window is a RollingWindow or a WindowBank channel.
+  template <typename Window>
+  void analyze(const Window& window, int dc, int64_t* power) const {
+    const int N = Window::length;
+    int samples[N];
+    int start = window.writeIndex();
+    for (int k = 0; k < N; k++) samples[k] = window[(start + k) % N] - dc;
+
+    for (int b = 0; b < bins_; b++) {
+      int64_t coeff = coeff_[b];
+      int32_t s1 = 0, s2 = 0;
+      for (int k = 0; k < N; k++) {
+        int32_t s0 = samples[k] + (int32_t)((coeff * s1) >> goertzelShift) - s2;
+        s2 = s1;
+        s1 = s0;
+      }
+      power[b] = (int64_t)s1 * s1 + (int64_t)s2 * s2 - (((coeff * s1) >> goertzelShift) * s2);
+    }
+  }
+
+private:
+  int32_t coeff_[MaxBins];
+  float frequencyHz_[MaxBins];
+  int bins_;
+};
+
+// Result of one spectral window.
+struct BandEnergy {
+  int64_t burst;      // summed power in the burst band
+  int64_t reference;  // summed power in the neighbouring reference bands
+  int ratioQ8;        // mean per-bin burst/reference power, Q8
+  float peakHz;       // strongest bin in the burst band
+};
+
+const int spectrumUnavailable = -1;
+
+// Burst band (burstFreqMin..burstFreqMax) plus reference bands just below and
+// above it, sampled at the bin spacing of a signalWindow block.
+class BandEnergyAnalyzer {
+public:
+  // Burst band plus reference bins at the spacing of a signalWindow block.
+  static const int maxBins = 64;
+
+  explicit BandEnergyAnalyzer(float rateHz = (float)sampleRateHz) { configure(rateHz); }
+
+  void configure(float rateHz) {
+    bank_ = GoertzelBank<maxBins>();
+    float spacing = rateHz / signalWindow;
+    float nyquist = rateHz / 2;
+
+    burstBins_ = 0;
+    for (float f = burstFreqMin; f <= burstFreqMax + 0.01f && f < nyquist; f += spacing) {
+      if (bank_.addBin(f, rateHz)) burstBins_++;
+    }
+    referenceBins_ = 0;
+    for (int i = 1; i <= referenceBandBins; i++) {
+      float below = burstFreqMin - i * spacing;
+      float above = burstFreqMax + i * spacing;
+      if (below > 0 && bank_.addBin(below, rateHz)) referenceBins_++;
+      if (above < nyquist && bank_.addBin(above, rateHz)) referenceBins_++;
+    }
+  }
+
+  int bins() const { return bank_.bins(); }
+
+  template <typename Window>
+  BandEnergy analyze(const Window& window) const {
+    int64_t power[maxBins];
+    bank_.analyze(window, window.mean(), power);
+
+    BandEnergy energy;
+    energy.burst = 0;
+    energy.reference = 0;
+    energy.peakHz = 0;
+    int64_t peak = -1;
+    for (int b = 0; b < burstBins_; b++) {
+      energy.burst += power[b];
+      if (power[b] > peak) {
+        peak = power[b];
+        energy.peakHz = bank_.frequency(b);
+      }
+    }
+    for (int b = burstBins_; b < burstBins_ + referenceBins_; b++) energy.reference += power[b];
+
+    if (burstBins_ == 0 || referenceBins_ == 0) {
+      energy.ratioQ8 = spectrumUnavailable;
+    } else {
+      int64_t ratio = (energy.burst * referenceBins_ * 256) / (energy.reference * burstBins_ + 1);
+      energy.ratioQ8 = ratio > 0x7fffffff ? 0x7fffffff : (int)ratio;
+    }
+    return energy;
+  }
+
+private:
+  GoertzelBank<maxBins> bank_;
+  int burstBins_;
+  int referenceBins_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_GOERTZEL_H
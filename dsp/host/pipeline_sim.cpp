@@ -0,0 +1,268 @@
+// Runs the acquisition/analysis/network pipeline on std::threads with a
+// simulated ADC and reports dropped samples, sample-to-decision latency and
+// telemetry volume (binary batches against the old per-snapshot JSON), and
+// the size of the raw waveform captures uploaded on detection events.
+//
+//   pipeline_sim [--seconds S] [--network-ms MS] [--coupled] [--capture-out PATH]
+//
+// --network-ms sets the worst-case simulated POST time (default 1500, the
+// firmware's HTTP timeout). --coupled runs the network send inline on the
+// analysis thread, the way loop() used to, for comparison. --capture-out
+// writes the first encoded capture to PATH (decode with backend/waveform.js).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "dsp/host/trace.h"
+#include "dsp/pipeline.h"
+
+using namespace leakdsp;
+using namespace leakdsp::host;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+static SteadyClock::time_point epoch = SteadyClock::now();
+
+static uint32_t nowUs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - epoch).count();
+}
+
+// Simulated ADC: loops over the measurement part of a synthetic trace.
+class SimulatedAdc : public SampleSource {
+public:
+  explicit SimulatedAdc(const Trace& trace) : trace_(trace), next_(calibrationSamples) {}
+
+  bool read(int* values, int count) {
+    if (next_ >= trace_.size()) next_ = calibrationSamples;
+    for (int s = 0; s < count; s++) values[s] = trace_[next_].values[s];
+    next_++;
+    return true;
+  }
+
+private:
+  const Trace& trace_;
+  size_t next_;
+};
+
+// Simulated HTTP POST: usually fast, occasionally up to the full timeout.
+class SimulatedNetwork {
+public:
+  explicit SimulatedNetwork(int worstMs) : worstMs_(worstMs), rng_(7) {}
+
+  void send() {
+    std::uniform_int_distribution<int> roll(0, 99);
+    int ms = roll(rng_) < 5 ? worstMs_ : 20 + roll(rng_) % 40;
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+
+private:
+  int worstMs_;
+  std::mt19937 rng_;
+};
+
+// Network side of the firmware: reports snapshots by exception and sends
+// ready batches. Also sizes the JSON body the firmware used to POST for every
+// snapshot.
+class Uplink {
+public:
+  explicit Uplink(SimulatedNetwork& network)
+      : network_(network), records_(0), requests_(0), bytes_(0), jsonBytes_(0), captures_(0), captureBytes_(0),
+        captureSamples_(0) {}
+
+  void send(const TelemetrySnapshot& snapshot) {
+    records_++;
+    jsonBytes_ += jsonSize(snapshot);
+    TelemetryRecord record = telemetryRecord(snapshot);
+    if (reporter_.offer(record) != ReportSuppressed) batch_.add(record);
+    if (!batch_.ready(record.timeMs)) return;
+    network_.send();
+    requests_++;
+    bytes_ += batch_.size();
+    batch_.clear();
+  }
+
+  // Uploads a pending waveform capture, if any.
+  void sendCapture(WaveformUpload& upload, const char* outPath) {
+    if (!upload.ready.load(std::memory_order_acquire)) return;
+    network_.send();
+    if (captures_ == 0 && outPath) {
+      FILE* out = fopen(outPath, "wb");
+      if (out) {
+        fwrite(upload.bytes, 1, upload.size, out);
+        fclose(out);
+      }
+    }
+    captures_++;
+    captureBytes_ += upload.size;
+    captureSamples_ += (uint64_t)(upload.bytes[6] | upload.bytes[7] << 8) * numSensors;
+    upload.ready.store(false, std::memory_order_release);
+  }
+
+  uint32_t captures() const { return captures_; }
+  uint64_t captureBytes() const { return captureBytes_; }
+  uint64_t captureSamples() const { return captureSamples_; }
+  uint32_t records() const { return records_; }
+  uint32_t reported() const { return reporter_.sent(); }
+  uint32_t requests() const { return requests_; }
+  uint64_t bytes() const { return bytes_; }
+  uint64_t jsonBytes() const { return jsonBytes_; }
+
+private:
+  static int jsonSize(const TelemetrySnapshot& snapshot) {
+    const LeakDetectionState& state = snapshot.state;
+    const Decision& decision = snapshot.decision;
+    char body[640];
+    return snprintf(body, sizeof(body),
+                    "{\"sensor1\": %d,\"sensor2\": %d,\"sensor3\": %d,\"leak_confirmed\": %d,"
+                    "\"burst_confirmed\": %d,\"leak_location\": \"%s\",\"confidence\": %.2f,"
+                    "\"correlation_score\": %d,\"stability_score\": %d,\"environmental_noise\": %d,"
+                    "\"active_sensors\": %d,\"burst_type\": \"%s\",\"burst_intensity\": %.2f,"
+                    "\"timestamp\": %u}",
+                    snapshot.sensorAverage[0], snapshot.sensorAverage[1], snapshot.sensorAverage[2],
+                    decision.leakConfirmed ? 1 : 0,
+                    decision.burstConfirmed || decision.catastrophicConfirmed ? 1 : 0, state.location,
+                    (float)state.confidence, snapshot.correlationScore, state.stabilityScore,
+                    state.environmentalNoise ? 1 : 0, decision.activeSensors, state.burstType,
+                    state.burstIntensity10 / 10.0f, decision.timeMs);
+  }
+
+  SimulatedNetwork& network_;
+  ExceptionReporter reporter_;
+  TelemetryBatch batch_;
+  uint32_t records_;
+  uint32_t requests_;
+  uint64_t bytes_;
+  uint64_t jsonBytes_;
+  uint32_t captures_;
+  uint64_t captureBytes_;
+  uint64_t captureSamples_;
+};
+
+static uint32_t percentile(std::vector<uint32_t>& values, double p) {
+  if (values.empty()) return 0;
+  size_t index = (size_t)(p * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+int main(int argc, char** argv) {
+  int seconds = 10;
+  int networkMs = 1500;
+  bool coupled = false;
+  const char* captureOut = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--network-ms") == 0 && i + 1 < argc) networkMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--coupled") == 0) coupled = true;
+    else if (strcmp(argv[i], "--capture-out") == 0 && i + 1 < argc) captureOut = argv[++i];
+    else {
+      fprintf(stderr, "usage: %s [--seconds S] [--network-ms MS] [--coupled] [--capture-out PATH]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  Trace trace = synthesizeTrace(60, 1);
+  TraceClock clock;
+  LeakDetector detector(clock);
+  for (int i = 0; i < calibrationSamples; i++) detector.addCalibrationSample(trace[i].values);
+
+  static SampleRing samples;
+  static TelemetryRing telemetry;
+  static WaveformUpload captureSlot;
+  SimulatedAdc adc(trace);
+  AcquisitionStage acquisition(adc, samples);
+  AnalysisStage analysis(detector, samples, telemetry, &captureSlot);
+  SimulatedNetwork network(networkMs);
+  Uplink uplink(network);
+
+  std::atomic<bool> running(true);
+  std::atomic<uint32_t> maxOccupancy(0);
+  std::vector<uint32_t> latencyUs;
+  latencyUs.reserve((size_t)seconds * sampleRateHz + 1024);
+
+  // Acquisition: fixed-rate producer
+  std::thread producer([&]() {
+    const std::chrono::microseconds period(1000000 / sampleRateHz);
+    SteadyClock::time_point next = SteadyClock::now();
+    SteadyClock::time_point end = next + std::chrono::seconds(seconds);
+    while (next < end) {
+      uint32_t us = nowUs();
+      acquisition.sample(us / 1000, us);
+      uint32_t occupancy = samples.size();
+      if (occupancy > maxOccupancy.load()) maxOccupancy.store(occupancy);
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+    running = false;
+  });
+
+  // Analysis: drains samples, optionally also sends (old single-loop design)
+  std::thread consumer([&]() {
+    SampleFrame frame;
+    while (running || !samples.empty()) {
+      if (analysis.drain(1, &frame)) {
+        latencyUs.push_back(nowUs() - frame.timeUs);
+        if (coupled) {
+          TelemetrySnapshot snapshot;
+          if (telemetry.pop(snapshot)) uplink.send(snapshot);
+          uplink.sendCapture(captureSlot, captureOut);
+        }
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+      }
+    }
+  });
+
+  // Network: independent consumer of telemetry snapshots
+  std::thread sender;
+  if (!coupled) {
+    sender = std::thread([&]() {
+      TelemetrySnapshot snapshot;
+      while (running || !telemetry.empty()) {
+        uplink.sendCapture(captureSlot, captureOut);
+        if (telemetry.pop(snapshot)) {
+          uplink.send(snapshot);
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+  }
+
+  producer.join();
+  consumer.join();
+  if (sender.joinable()) sender.join();
+
+  printf("mode: %s, %d s at %d Hz, ring %u frames, worst POST %d ms\n",
+         coupled ? "coupled (network on analysis thread)" : "decoupled", seconds, sampleRateHz,
+         SampleRing::capacity(), networkMs);
+  printf("samples: %u produced, %u dropped (ring full), %u analysed, max ring occupancy %u\n",
+         acquisition.produced(), acquisition.dropped(), analysis.processed(), maxOccupancy.load());
+  printf("telemetry: %u snapshots, %u reported by exception, %u dropped\n", uplink.records(), uplink.reported(),
+         analysis.telemetryDropped());
+  printf("uplink: %u binary requests, %llu bytes (%.1f B/report); per-snapshot JSON: %u requests, %llu bytes (%.1f B/snapshot)\n",
+         uplink.requests(), (unsigned long long)uplink.bytes(),
+         uplink.reported() ? (double)uplink.bytes() / uplink.reported() : 0.0, uplink.records(),
+         (unsigned long long)uplink.jsonBytes(),
+         uplink.records() ? (double)uplink.jsonBytes() / uplink.records() : 0.0);
+  printf("waveform captures: %u uploaded, %u events skipped while one was pending", uplink.captures(),
+         analysis.capturesSkipped());
+  if (uplink.captures() > 0) {
+    printf("; %llu bytes for %llu raw samples (%.2f bits/sample, %.1fx smaller than int16)",
+           (unsigned long long)uplink.captureBytes(), (unsigned long long)uplink.captureSamples(),
+           uplink.captureBytes() * 8.0 / uplink.captureSamples(),
+           uplink.captureSamples() * 2.0 / uplink.captureBytes());
+  }
+  printf("\n");
+  printf("sample-to-decision latency: p50 %u us, p99 %u us, max %u us\n",
+         percentile(latencyUs, 0.50), percentile(latencyUs, 0.99), percentile(latencyUs, 1.0));
+  return 0;
+}
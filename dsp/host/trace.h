@@ -0,0 +1,152 @@
+#ifndef LEAKDSP_HOST_TRACE_H
+#define LEAKDSP_HOST_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dsp/detector_config.h"
+#include "dsp/platform.h"
+
+// Recorded multi-sensor ADC traces for the host build.
+//
+// Trace files are CSV, one frame per line: t_ms,s1,s2,...,sN. Lines starting
+// with '#' are comments. The first calibrationSamples frames are the boot
+// calibration, exactly as setup() samples them on the board.
+
+namespace leakdsp {
+namespace host {
+
+struct Frame {
+  uint32_t timeMs;
+  int values[numSensors];
+};
+
+typedef std::vector<Frame> Trace;
+
+inline bool loadTrace(const char* path, Trace& trace) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+
+  char line[512];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+    Frame frame;
+    char* cursor = line;
+    frame.timeMs = (uint32_t)strtoul(cursor, &cursor, 10);
+    bool complete = true;
+    for (int s = 0; s < numSensors; s++) {
+      if (*cursor != ',') {
+        complete = false;
+        break;
+      }
+      frame.values[s] = (int)strtol(cursor + 1, &cursor, 10);
+    }
+    if (complete) trace.push_back(frame);
+  }
+  fclose(file);
+  return true;
+}
+
+inline bool saveTrace(const char* path, const Trace& trace) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  fprintf(file, "# t_ms");
+  for (int s = 0; s < numSensors; s++) fprintf(file, ",s%d", s + 1);
+  fprintf(file, "\n");
+  for (size_t i = 0; i < trace.size(); i++) {
+    fprintf(file, "%u", trace[i].timeMs);
+    for (int s = 0; s < numSensors; s++) fprintf(file, ",%d", trace[i].values[s]);
+    fprintf(file, "\n");
+  }
+  fclose(file);
+  return true;
+}
+
+// Synthetic trace at sampleRateHz: calibration, quiet flow, then a leak, a
+// burst and a catastrophic episode separated by quiet periods. Levels are
+// sensor averages; sensor 1 carries the strongest signal. Burst episodes
+// carry a 45 Hz component, the leak a 10 Hz one, delayed one frame per sensor.
+inline Trace synthesizeTrace(int seconds, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> noise(0.0f, 2.0f);
+
+  Trace trace;
+  uint32_t t = 0;
+  for (int i = 0; i < calibrationSamples; i++) {
+    Frame frame;
+    frame.timeMs = t;
+    for (int s = 0; s < numSensors; s++) frame.values[s] = 30 + (int)lroundf(noise(rng));
+    trace.push_back(frame);
+    t += calibrationIntervalMs;
+  }
+
+  const int frameMs = 1000 / sampleRateHz;
+  const int frames = seconds * 1000 / frameMs;
+  const float levels[] = {30, 90, 30, 180, 30, 340, 30};
+  const int phases = sizeof(levels) / sizeof(levels[0]);
+  const float sensorGain[] = {1.0f, 0.9f, 0.8f, 0.75f, 0.7f, 0.65f, 0.6f, 0.55f,
+                              0.5f, 0.45f, 0.4f, 0.35f, 0.3f, 0.25f, 0.2f, 0.15f};
+  float level = levels[0];
+  for (int i = 0; i < frames; i++) {
+    float target = levels[i * phases / frames];
+    level += (target - level) * 0.02f; // gradual onset, no single-sample spikes
+    float toneHz = target > 100 ? 45.0f : 10.0f;
+    float toneAmplitude = target > 30 ? 6.0f : 0.0f;
+    Frame frame;
+    frame.timeMs = t;
+    for (int s = 0; s < numSensors; s++) {
+      // The source sits near sensor 1; each further sensor hears it one frame later
+      float tone = toneAmplitude * sinf(2.0f * 3.14159265f * toneHz * (i - s) / sampleRateHz);
+      float gain = 1.0f - (1.0f - sensorGain[s % 16]) * (level - 30) / 310.0f;
+      int value = (int)lroundf((level + tone) * gain + noise(rng));
+      frame.values[s] = value < 0 ? 0 : value;
+    }
+    trace.push_back(frame);
+    t += frameMs;
+  }
+  return trace;
+}
+
+// Clock driven by trace timestamps.
+class TraceClock : public Clock {
+public:
+  TraceClock() : now_(0) {}
+  uint32_t nowMs() { return now_; }
+  void set(uint32_t now) { now_ = now; }
+
+private:
+  uint32_t now_;
+};
+
+// Replays an in-memory trace and advances the clock to each frame's timestamp.
+class TraceSource : public SampleSource {
+public:
+  TraceSource(const Trace& trace, TraceClock& clock, size_t begin = 0)
+      : trace_(trace), clock_(clock), next_(begin) {}
+
+  bool read(int* values, int count) {
+    if (next_ >= trace_.size()) return false;
+    const Frame& frame = trace_[next_++];
+    clock_.set(frame.timeMs);
+    for (int s = 0; s < count; s++) values[s] = frame.values[s];
+    return true;
+  }
+
+  size_t position() const { return next_; }
+
+private:
+  const Trace& trace_;
+  TraceClock& clock_;
+  size_t next_;
+};
+
+} // namespace host
+} // namespace leakdsp
+
+#endif // LEAKDSP_HOST_TRACE_H
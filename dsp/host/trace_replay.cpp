@@ -0,0 +1,675 @@
+// Replays a recorded ADC trace through the leak detector and reports
+// throughput, per-stage cost and the sequence of detection decisions.
+//
+//   trace_replay <trace.csv> [--repeat N] [--decisions out.txt]
+//   trace_replay <trace.csv> --compare-math [--repeat N]
+//   trace_replay <trace.csv> --warm-start [--snapshot cal.bin] [--reset-at MS]
+//   trace_replay <trace.csv> --report [--tolerance MEAN,EXTREME,RMS,BAND] [--heartbeat-ms MS]
+//   trace_replay --bench-spectral
+//   trace_replay --bench-tdoa
+//   trace_replay --bench-correlation
+//   trace_replay --synth <out.csv> [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LEAKDSP_HAVE_TSC 1
+#endif
+
+#include "dsp/calibration.h"
+#include "dsp/file_calibration_store.h"
+#include "dsp/host/trace.h"
+#include "dsp/leak_detector.h"
+#include "dsp/pipeline.h"
+#include "dsp/report_by_exception.h"
+
+using namespace leakdsp;
+using namespace leakdsp::host;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+static const char* stageNames[StageCount] = {
+  "ingest", "thresholds", "filters", "state machine", "spectral", "correlation", "decision"
+};
+
+static long long elapsedNs(SteadyClock::time_point from, SteadyClock::time_point to) {
+  return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+// Accumulates wall time between consecutive stage completions.
+class StageTimer : public StageObserver {
+public:
+  StageTimer() {
+    for (int i = 0; i < StageCount; i++) totalNs[i] = 0;
+  }
+
+  void frameStart() { last_ = SteadyClock::now(); }
+
+  void stageComplete(Stage stage) {
+    SteadyClock::time_point now = SteadyClock::now();
+    totalNs[stage] += elapsedNs(last_, now);
+    last_ = now;
+  }
+
+  long long totalNs[StageCount];
+
+private:
+  SteadyClock::time_point last_;
+};
+
+template <typename Detector>
+static void calibrate(Detector& detector, TraceSource& source) {
+  int samples[numSensors];
+  for (int i = 0; i < calibrationSamples && source.read(samples, numSensors); i++) {
+    detector.addCalibrationSample(samples);
+  }
+}
+
+static void printDecision(FILE* out, const LeakDetector& detector) {
+  const Decision& d = detector.decision();
+  const LeakDetectionState& state = detector.leakState();
+  fprintf(out, "%10u ms  %-18s leak=%d burst=%d catastrophic=%d active=%d conf=%d peak=%.0fHz loc=%s\n",
+          d.timeMs, state.burstType, d.leakConfirmed, d.burstConfirmed, d.catastrophicConfirmed,
+          d.activeSensors, state.confidence, state.burstFrequency, state.location);
+}
+
+// Per-frame outcome the two sample-type instantiations must agree on.
+struct FrameOutcome {
+  bool leak, burst, catastrophic, noise;
+  const char* burstType;
+
+  bool operator==(const FrameOutcome& o) const {
+    return leak == o.leak && burst == o.burst && catastrophic == o.catastrophic && noise == o.noise &&
+           strcmp(burstType, o.burstType) == 0;
+  }
+};
+
+// Best-of-repeat ns/frame; the outcome of every frame of the last run.
+template <typename Detector>
+static double replayMath(const Trace& trace, int repeat, std::vector<FrameOutcome>& outcomes) {
+  long long bestNs = -1;
+  for (int r = 0; r < repeat; r++) {
+    TraceClock clock;
+    TraceSource source(trace, clock);
+    Detector detector(clock);
+    calibrate(detector, source);
+    outcomes.clear();
+
+    int samples[numSensors];
+    long long ns = 0;
+    while (source.read(samples, numSensors)) {
+      SteadyClock::time_point start = SteadyClock::now();
+      detector.process(samples);
+      ns += elapsedNs(start, SteadyClock::now());
+
+      const Decision& d = detector.decision();
+      FrameOutcome o = {d.leakConfirmed, d.burstConfirmed, d.catastrophicConfirmed,
+                        detector.leakState().environmentalNoise, detector.leakState().burstType};
+      outcomes.push_back(o);
+    }
+    if (bestNs < 0 || ns < bestNs) bestNs = ns;
+  }
+  return outcomes.empty() ? 0 : (double)bestNs / outcomes.size();
+}
+
+// Float reference against the fixed-point detector on one trace.
+static int compareMath(const Trace& trace, int repeat) {
+  std::vector<FrameOutcome> floatOutcomes, fixedOutcomes;
+  double floatNs = replayMath<FloatLeakDetector>(trace, repeat, floatOutcomes);
+  double fixedNs = replayMath<FixedLeakDetector>(trace, repeat, fixedOutcomes);
+
+  int mismatches = 0;
+  long long firstMismatch = -1;
+  for (size_t i = 0; i < floatOutcomes.size() && i < fixedOutcomes.size(); i++) {
+    if (floatOutcomes[i] == fixedOutcomes[i]) continue;
+    if (firstMismatch < 0) firstMismatch = (long long)i;
+    mismatches++;
+  }
+
+  printf("%-6s %10s %14s %16s\n", "math", "ns/frame", "sensor bytes", "detector bytes");
+  printf("%-6s %10.0f %14zu %16zu\n", "float", floatNs,
+         sizeof(FloatLeakDetector::SensorBank) / numSensors, sizeof(FloatLeakDetector));
+  printf("%-6s %10.0f %14zu %16zu\n", "fixed", fixedNs,
+         sizeof(FixedLeakDetector::SensorBank) / numSensors, sizeof(FixedLeakDetector));
+  printf("decision mismatches: %d of %zu frames", mismatches, floatOutcomes.size());
+  if (firstMismatch >= 0) printf(" (first at frame %lld)", firstMismatch);
+  printf("\n");
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Frame index of the first frame at or after timeMs, or the trace size.
+static size_t frameAt(const Trace& trace, uint32_t timeMs) {
+  size_t i = calibrationSamples;
+  while (i < trace.size() && trace[i].timeMs < timeMs) i++;
+  return i;
+}
+
+// Processes frames until the first confirmed detection; returns its frame
+// time, or -1 when the trace ends first.
+static long long firstDetection(LeakDetector& detector, TraceSource& source) {
+  int samples[numSensors];
+  while (source.read(samples, numSensors)) {
+    if (detector.process(samples).leakConfirmed) return detector.decision().timeMs;
+  }
+  return -1;
+}
+
+static void printBoot(const char* name, long long armedMs, long long detectedMs, long long resetMs) {
+  printf("%s boot: detecting %.2f s after reset, ", name, (armedMs - resetMs) / 1000.0);
+  if (detectedMs < 0) printf("no detection before the trace ends\n");
+  else printf("first detection %.2f s after reset\n", (detectedMs - resetMs) / 1000.0);
+}
+
+// Time-to-first-detection after a reset, cold boot against warm start. The
+// device runs from the trace's boot calibration, checkpointing its baselines
+// to snapshotPath every 10 s of trace time, and resets at resetAtMs (default:
+// when an uninterrupted run first confirms an event, i.e. a reboot during a
+// leak). A cold boot then samples calibrationSamples frames, one per
+// calibrationIntervalMs, from the live trace before detecting; a warm boot
+// restores the snapshot and detects from the next frame.
+static int warmStart(const Trace& trace, const char* snapshotPath, long long resetAtMs) {
+  TraceClock clock;
+  if (resetAtMs < 0) {
+    TraceSource source(trace, clock);
+    LeakDetector detector(clock);
+    calibrate(detector, source);
+    resetAtMs = firstDetection(detector, source);
+    if (resetAtMs < 0) {
+      fprintf(stderr, "no detection in the trace; pass --reset-at\n");
+      return 1;
+    }
+  }
+  const size_t resetFrame = frameAt(trace, (uint32_t)resetAtMs);
+  if (resetFrame >= trace.size()) {
+    fprintf(stderr, "--reset-at %lld ms is past the end of the trace\n", resetAtMs);
+    return 1;
+  }
+  resetAtMs = trace[resetFrame].timeMs;
+
+  // Before the reset: cold boot from the trace's calibration, checkpointing
+  FileCalibrationStore store(snapshotPath);
+  remove(snapshotPath);
+  CalibrationCheckpoint<LeakDetector> checkpoint(store, 10000);
+  {
+    TraceSource source(trace, clock);
+    LeakDetector detector(clock);
+    calibrate(detector, source);
+    checkpoint.save(detector);
+    int samples[numSensors];
+    while (source.position() < resetFrame && source.read(samples, numSensors)) {
+      detector.process(samples);
+      checkpoint.poll(detector, clock.nowMs());
+    }
+  }
+
+  // Cold boot: calibrate from the live signal, then detect
+  TraceSource coldSource(trace, clock, resetFrame);
+  LeakDetector cold(clock);
+  int samples[numSensors];
+  int taken = 0;
+  uint32_t nextSampleMs = (uint32_t)resetAtMs;
+  while (taken < calibrationSamples && coldSource.read(samples, numSensors)) {
+    if (clock.nowMs() < nextSampleMs) continue;
+    cold.addCalibrationSample(samples);
+    nextSampleMs += calibrationIntervalMs;
+    taken++;
+  }
+  long long coldArmedMs = clock.nowMs();
+  long long coldDetectedMs = firstDetection(cold, coldSource);
+
+  // Warm boot: restore the last checkpoint
+  TraceSource warmSource(trace, clock, resetFrame);
+  LeakDetector warm(clock);
+  CalibrationCheckpoint<LeakDetector>::Snapshot restored;
+  CalibrationCheckpoint<LeakDetector> reader(store);
+  if (!reader.restore(warm, &restored)) {
+    fprintf(stderr, "cannot restore %s\n", snapshotPath);
+    return 1;
+  }
+  long long warmDetectedMs = firstDetection(warm, warmSource);
+
+  printf("reset at %lld ms; snapshot %s: %d bytes, %u checkpoint%s before the reset\n", resetAtMs, snapshotPath,
+         calibrationRecordBytes(numSensors), checkpoint.saves(), checkpoint.saves() == 1 ? "" : "s");
+  for (int s = 0; s < numSensors; s++) {
+    const Thresholds& t = restored.thresholds[s];
+    printf("  sensor %d: restored baseline %.1f +- %.1f, thresholds %d/%d/%d; cold boot learned %d\n", s + 1,
+           restored.noiseMeanQ4[s] / 16.0, sqrt(restored.noiseVarianceQ4[s] / 16.0), t.leak, t.burst, t.catastrophic,
+           cold.noiseBaseline(s));
+  }
+  printBoot("cold", coldArmedMs, coldDetectedMs, resetAtMs);
+  printBoot("warm", resetAtMs, warmDetectedMs, resetAtMs);
+  return 0;
+}
+
+// Cost of one Goertzel band-energy window for one sensor.
+// Telemetry a firmware sends over the trace.
+struct UplinkVolume {
+  UplinkVolume() : rows(0), requests(0), bytes(0) {}
+
+  void add(const TelemetryRecord& record) {
+    batch.add(record);
+    rows++;
+    flush(record.timeMs, false);
+  }
+
+  void flush(uint32_t nowMs, bool all) {
+    if (batch.empty() || (!all && !batch.ready(nowMs))) return;
+    requests++;
+    bytes += batch.size();
+    batch.clear();
+  }
+
+  TelemetryBatch batch;
+  uint32_t rows;
+  uint32_t requests;
+  uint64_t bytes;
+};
+
+static void printVolume(const char* name, const UplinkVolume& volume, double hours) {
+  printf("  %-24s %8u rows %7u requests %9llu bytes   %8.0f rows/day %6.1f MB/day\n", name, volume.rows,
+         volume.requests, (unsigned long long)volume.bytes, volume.rows * 24 / hours,
+         volume.bytes * 24 / hours / 1e6);
+}
+
+// Uplink volume of the previous firmware (a record every 100 ms, sent in
+// batches) against per-window summaries reported by exception, through the
+// same analysis stage and codec the board runs.
+static int reportByException(const Trace& trace, const ReportTolerance& tolerance) {
+  const uint32_t legacyIntervalMs = 100;
+  TraceClock clock;
+  TraceSource source(trace, clock);
+  LeakDetector detector(clock);
+  calibrate(detector, source);
+
+  static SampleRing samples;
+  static TelemetryRing telemetry;
+  AnalysisStage analysis(detector, samples, telemetry);
+  ExceptionReporter reporter(tolerance);
+  UplinkVolume legacy, exception;
+  uint32_t reasons[ReportTransition + 1] = {0};
+  uint32_t offered[2] = {0, 0};  // quiet, in alarm
+  uint32_t sent[2] = {0, 0};
+
+  SampleFrame frame;
+  frame.sequence = 0;
+  frame.timeUs = 0;
+  bool haveLegacy = false;
+  uint32_t lastLegacyMs = 0;
+  uint32_t firstMs = 0;
+  while (source.read(frame.values, numSensors)) {
+    frame.timeMs = clock.nowMs();
+    if (frame.sequence == 0) firstMs = frame.timeMs;
+    samples.push(frame);
+    frame.sequence++;
+    analysis.drain(1);
+
+    if (!haveLegacy || frame.timeMs - lastLegacyMs >= legacyIntervalMs) {
+      haveLegacy = true;
+      lastLegacyMs = frame.timeMs;
+      TelemetrySnapshot snapshot;
+      for (int s = 0; s < numSensors; s++) snapshot.sensorAverage[s] = detector.average(s);
+      snapshot.decision = detector.decision();
+      snapshot.state = detector.leakState();
+      snapshot.correlationScore = detector.correlation().agreementScore;
+      TelemetryRecord record = telemetryRecord(snapshot);
+      record.flags &= ~TelemetrySummary;
+      legacy.add(record);
+    }
+
+    TelemetrySnapshot snapshot;
+    while (telemetry.pop(snapshot)) {
+      TelemetryRecord record = telemetryRecord(snapshot);
+      ReportReason reason = reporter.offer(record);
+      int alarm = (record.flags & telemetryAlarmFlags) ? 1 : 0;
+      reasons[reason]++;
+      offered[alarm]++;
+      if (reason == ReportSuppressed) continue;
+      sent[alarm]++;
+      exception.add(record);
+    }
+    legacy.flush(frame.timeMs, false);
+    exception.flush(frame.timeMs, false);
+  }
+  legacy.flush(frame.timeMs, true);
+  exception.flush(frame.timeMs, true);
+
+  double hours = (frame.timeMs - firstMs) / 3600000.0;
+  printf("%.0f s after calibration; tolerance mean %d, min/max %d, rms %d, band %d counts; "
+         "heartbeat %u ms (%u ms in alarm)\n",
+         hours * 3600, tolerance.mean, tolerance.extreme, tolerance.rms, tolerance.band, tolerance.heartbeatMs,
+         tolerance.alarmHeartbeatMs);
+  printVolume("every 100 ms", legacy, hours);
+  printVolume("by exception", exception, hours);
+  printf("  %u window summaries: %u transitions, %u feature deltas, %u heartbeats, %u suppressed\n",
+         reporter.offered(), reasons[ReportTransition], reasons[ReportFeature], reasons[ReportHeartbeat],
+         reasons[ReportSuppressed]);
+  printf("  quiet: %u of %u windows reported (%.1f s apart); in alarm: %u of %u\n", sent[0], offered[0],
+         sent[0] ? offered[0] * telemetryWindowMs / 1000.0 / sent[0] : 0.0, sent[1], offered[1]);
+  printf("reduction: %.1fx fewer rows, %.1fx fewer bytes, %.1fx fewer requests\n",
+         exception.rows ? (double)legacy.rows / exception.rows : 0.0,
+         exception.bytes ? (double)legacy.bytes / exception.bytes : 0.0,
+         exception.requests ? (double)legacy.requests / exception.requests : 0.0);
+  return 0;
+}
+
+static int benchSpectral() {
+  BandEnergyAnalyzer analyzer;
+  RollingWindow<signalWindow> window;
+  for (int i = 0; i < signalWindow; i++) {
+    window.push(200 + (int)(40 * sinf(2.0f * 3.14159265f * 45.0f * i / sampleRateHz)) + (i * 7919) % 11);
+  }
+
+  const int iterations = 200000;
+  volatile int sink = 0;
+  SteadyClock::time_point start = SteadyClock::now();
+#ifdef LEAKDSP_HAVE_TSC
+  unsigned long long tscStart = __rdtsc();
+#endif
+  for (int i = 0; i < iterations; i++) {
+    window.push(window.recent(signalWindow - 1));
+    sink = sink + analyzer.analyze(window).ratioQ8;
+  }
+#ifdef LEAKDSP_HAVE_TSC
+  unsigned long long cycles = __rdtsc() - tscStart;
+#endif
+  long long ns = elapsedNs(start, SteadyClock::now());
+
+  printf("spectral window: %d samples, %d Goertzel bins at %d Hz\n",
+         signalWindow, analyzer.bins(), sampleRateHz);
+  printf("  %.0f ns/window/sensor", (double)ns / iterations);
+#ifdef LEAKDSP_HAVE_TSC
+  printf(", %.0f TSC cycles/window/sensor", (double)cycles / iterations);
+#endif
+  printf("\n  amortized %.1f ns/sample/sensor (one window per %d samples)\n",
+         (double)ns / iterations / signalWindow, signalWindow);
+  return 0;
+}
+
+// Reference time-domain sweep: one O(N) dot product per lag.
+static DelayEstimate directDelay(const RollingWindow<signalWindow>& a,
+                                 const RollingWindow<signalWindow>& b, int maxLag) {
+  float x[signalWindow], y[signalWindow];
+  int meanA = a.mean(), meanB = b.mean();
+  for (int n = 0; n < signalWindow; n++) {
+    x[n] = (float)(a[(a.writeIndex() + n) % signalWindow] - meanA);
+    y[n] = (float)(b[(b.writeIndex() + n) % signalWindow] - meanB);
+  }
+  DelayEstimate best;
+  best.lagSamples = 0;
+  best.coefficient = 0;
+  best.valid = true;
+  float bestValue = 0;
+  for (int lag = -maxLag; lag <= maxLag; lag++) {
+    float sum = 0;
+    for (int n = 0; n < signalWindow; n++) {
+      int m = n + lag;
+      if (m >= 0 && m < signalWindow) sum += x[m] * y[n];
+    }
+    if (fabsf(sum) > fabsf(bestValue)) {
+      bestValue = sum;
+      best.lagSamples = (float)lag;
+    }
+  }
+  best.coefficient = bestValue;
+  return best;
+}
+
+// Cost of the FFT cross-correlation against a per-lag sweep, full lag range.
+static int benchTdoa() {
+  const int delay = 3;
+  const int maxLag = signalWindow - 1;
+  RollingWindow<signalWindow> a, b;
+  std::mt19937 rng(3);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+  float source[signalWindow + delay];
+  for (int i = 0; i < signalWindow + delay; i++) source[i] = 200 + noise(rng);
+  for (int n = 0; n < signalWindow; n++) {
+    a.push((int)source[n]);          // a hears the source `delay` frames after b
+    b.push((int)source[n + delay]);
+  }
+
+  CrossCorrelator<signalWindow> correlator;
+  const int iterations = 20000;
+  volatile float sink = 0;
+
+  SteadyClock::time_point start = SteadyClock::now();
+  DelayEstimate fft;
+  for (int i = 0; i < iterations; i++) {
+    fft = correlator.estimate(a, b, maxLag);
+    sink = sink + fft.lagSamples;
+  }
+  long long fftNs = elapsedNs(start, SteadyClock::now());
+
+  start = SteadyClock::now();
+  DelayEstimate direct;
+  for (int i = 0; i < iterations; i++) {
+    direct = directDelay(a, b, maxLag);
+    sink = sink + direct.lagSamples;
+  }
+  long long directNs = elapsedNs(start, SteadyClock::now());
+
+  const int lags = 2 * maxLag + 1;
+  printf("cross-correlation: %d-sample windows, %d-point FFT, %d lags, true delay %d\n",
+         signalWindow, CrossCorrelator<signalWindow>::fftSize, lags, delay);
+  printf("  fft:    %7.0f ns/pair, %6.1f M lags/s, lag %.2f (coefficient %.2f)\n",
+         (double)fftNs / iterations, lags * iterations * 1e3 / fftNs, fft.lagSamples, fft.coefficient);
+  printf("  direct: %7.0f ns/pair, %6.1f M lags/s, lag %.0f\n",
+         (double)directNs / iterations, lags * iterations * 1e3 / directNs, direct.lagSamples);
+  return 0;
+}
+
+// Pushes every frame through a window bank and co-moments; matrix 1 adds the
+// float correlation matrix per full frame, 2 the Q14 one.
+template <int S>
+static long long timeCorrelation(const std::vector<int>& samples, int frames, int matrix) {
+  WindowBank<S, signalWindow, int16_t> bank;
+  RollingCoMoments<S> moments;
+  float floatMatrix[RollingCoMoments<S>::pairs];
+  int32_t fixedMatrix[RollingCoMoments<S>::pairs];
+  int evicted[S];
+  volatile float sink = 0;
+
+  SteadyClock::time_point start = SteadyClock::now();
+  for (int i = 0; i < frames; i++) {
+    bank.push(&samples[i * S], evicted);
+    moments.update(&samples[i * S], evicted);
+    if (!bank.full() || matrix == 0) continue;
+    if (matrix == 1) {
+      moments.correlationMatrix(bank, floatMatrix);
+      sink = sink + floatMatrix[0];
+    } else {
+      moments.correlationMatrixQ14(bank, fixedMatrix);
+      sink = sink + fixedMatrix[0];
+    }
+  }
+  return elapsedNs(start, SteadyClock::now());
+}
+
+// Correlation stage and whole-frame cost for S sensors on a shared leak tone
+// plus independent noise.
+template <int S>
+static void benchCorrelationAt() {
+  const int frames = 20000;
+  std::mt19937 rng(S);
+  std::normal_distribution<float> noise(0.0f, 6.0f);
+  std::vector<int> samples(frames * S);
+  for (int i = 0; i < frames; i++) {
+    float tone = 40.0f * sinf(2.0f * 3.14159265f * 45.0f * i / sampleRateHz);
+    for (int s = 0; s < S; s++) samples[i * S + s] = 200 + (int)(tone + noise(rng));
+  }
+
+  typedef RollingCoMoments<S> Moments;
+  long long updateNs = -1, floatNs = -1, fixedNs = -1;
+  for (int r = 0; r < 5; r++) {
+    long long ns[3];
+    for (int matrix = 0; matrix < 3; matrix++) ns[matrix] = timeCorrelation<S>(samples, frames, matrix);
+    if (updateNs < 0 || ns[0] < updateNs) updateNs = ns[0];
+    if (floatNs < 0 || ns[1] < floatNs) floatNs = ns[1];
+    if (fixedNs < 0 || ns[2] < fixedNs) fixedNs = ns[2];
+  }
+  floatNs -= updateNs;
+  fixedNs -= updateNs;
+  const int measured = frames - (signalWindow - 1);
+
+  TraceClock clock;
+  BasicLeakDetector<FixedTraits, S> detector(clock);
+  for (int i = 0; i < calibrationSamples; i++) detector.addCalibrationSample(&samples[i * S]);
+  SteadyClock::time_point start = SteadyClock::now();
+  for (int i = 0; i < frames; i++) detector.processAt(&samples[i * S], (uint32_t)(i * 1000 / sampleRateHz));
+  long long frameNs = elapsedNs(start, SteadyClock::now());
+
+  printf("%7d %6d %10.1f %12.1f %12.1f %12.0f\n", S, Moments::pairs, (double)updateNs / frames,
+         (double)floatNs / measured, (double)fixedNs / measured, (double)frameNs / frames);
+}
+
+static int benchCorrelation() {
+  printf("per-frame ns; update = window bank push + co-moment update, matrix = every pair's coefficient\n");
+  printf("%7s %6s %10s %12s %12s %12s\n", "sensors", "pairs", "update", "float matrix", "Q14 matrix", "fixed frame");
+  benchCorrelationAt<3>();
+  benchCorrelationAt<4>();
+  benchCorrelationAt<6>();
+  benchCorrelationAt<8>();
+  benchCorrelationAt<12>();
+  benchCorrelationAt<16>();
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "--bench-spectral") == 0) return benchSpectral();
+  if (argc >= 2 && strcmp(argv[1], "--bench-tdoa") == 0) return benchTdoa();
+  if (argc >= 2 && strcmp(argv[1], "--bench-correlation") == 0) return benchCorrelation();
+
+  if (argc >= 3 && strcmp(argv[1], "--synth") == 0) {
+    int seconds = argc >= 4 ? atoi(argv[3]) : 60;
+    if (!saveTrace(argv[2], synthesizeTrace(seconds, 1))) {
+      fprintf(stderr, "cannot write %s\n", argv[2]);
+      return 1;
+    }
+    printf("wrote %d s synthetic trace to %s\n", seconds, argv[2]);
+    return 0;
+  }
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace.csv> [--repeat N] [--decisions out.txt]\n"
+                    "       %s <trace.csv> --compare-math [--repeat N]\n"
+                    "       %s <trace.csv> --warm-start [--snapshot cal.bin] [--reset-at MS]\n"
+                    "       %s <trace.csv> --report [--tolerance MEAN,EXTREME,RMS,BAND] [--heartbeat-ms MS]\n"
+                    "       %s --synth <out.csv> [seconds]\n"
+                    "       %s --bench-spectral\n"
+                    "       %s --bench-tdoa\n"
+                    "       %s --bench-correlation\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+  }
+
+  int repeat = 20;
+  const char* decisionsPath = 0;
+  bool compare = false;
+  bool warm = false;
+  const char* snapshotPath = "calibration.bin";
+  long long resetAtMs = -1;
+  bool report = false;
+  ReportTolerance tolerance;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--decisions") == 0 && i + 1 < argc) decisionsPath = argv[++i];
+    else if (strcmp(argv[i], "--compare-math") == 0) compare = true;
+    else if (strcmp(argv[i], "--warm-start") == 0) warm = true;
+    else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) snapshotPath = argv[++i];
+    else if (strcmp(argv[i], "--reset-at") == 0 && i + 1 < argc) resetAtMs = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--report") == 0) report = true;
+    else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      sscanf(argv[++i], "%d,%d,%d,%d", &tolerance.mean, &tolerance.extreme, &tolerance.rms, &tolerance.band);
+    } else if (strcmp(argv[i], "--heartbeat-ms") == 0 && i + 1 < argc) {
+      tolerance.heartbeatMs = (uint32_t)strtoul(argv[++i], 0, 10);
+    }
+  }
+  if (repeat < 1) repeat = 1;
+
+  Trace trace;
+  if (!loadTrace(argv[1], trace)) {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 1;
+  }
+  if (trace.size() <= (size_t)calibrationSamples) {
+    fprintf(stderr, "trace has %zu frames, need more than %d calibration frames\n",
+            trace.size(), calibrationSamples);
+    return 1;
+  }
+  if (compare) return compareMath(trace, repeat);
+  if (warm) return warmStart(trace, snapshotPath, resetAtMs);
+  if (report) return reportByException(trace, tolerance);
+  const size_t frames = trace.size() - calibrationSamples;
+
+  // Pass 1: unobserved throughput.
+  long long bestNs = -1;
+  for (int r = 0; r < repeat; r++) {
+    TraceClock clock;
+    TraceSource source(trace, clock);
+    LeakDetector detector(clock);
+    calibrate(detector, source);
+
+    SteadyClock::time_point start = SteadyClock::now();
+    while (detector.step(source)) {
+    }
+    long long ns = elapsedNs(start, SteadyClock::now());
+    if (bestNs < 0 || ns < bestNs) bestNs = ns;
+  }
+
+  // Pass 2: per-stage timing and the decision sequence.
+  TraceClock clock;
+  TraceSource source(trace, clock);
+  LeakDetector detector(clock);
+  StageTimer timer;
+  calibrate(detector, source);
+  detector.setObserver(&timer);
+
+  FILE* decisions = decisionsPath ? fopen(decisionsPath, "w") : 0;
+  if (decisionsPath && !decisions) {
+    fprintf(stderr, "cannot write %s\n", decisionsPath);
+    return 1;
+  }
+
+  long long maxFrameNs = 0;
+  int transitions = 0;
+  const char* lastType = 0;
+  bool lastConfirmed = false;
+  int samples[numSensors];
+  while (source.read(samples, numSensors)) {
+    SteadyClock::time_point start = SteadyClock::now();
+    timer.frameStart();
+    detector.process(samples);
+    long long ns = elapsedNs(start, SteadyClock::now());
+    if (ns > maxFrameNs) maxFrameNs = ns;
+
+    const LeakDetectionState& state = detector.leakState();
+    bool confirmed = detector.decision().leakConfirmed;
+    if (state.burstType != lastType || confirmed != lastConfirmed) {
+      transitions++;
+      printDecision(stdout, detector);
+      if (decisions) printDecision(decisions, detector);
+      lastType = state.burstType;
+      lastConfirmed = confirmed;
+    }
+  }
+  if (decisions) fclose(decisions);
+
+  printf("\ntrace: %s (%zu frames after %d calibration frames, %d sensors)\n",
+         argv[1], frames, calibrationSamples, numSensors);
+  printf("throughput: %.0f frames/s, %.0f samples/s (best of %d)\n",
+         frames * 1e9 / bestNs, frames * numSensors * 1e9 / bestNs, repeat);
+  printf("frame cost: %.0f ns mean, %lld ns max (frame budget %d us at %d Hz)\n",
+         (double)bestNs / frames, maxFrameNs, 1000000 / sampleRateHz, sampleRateHz);
+  printf("per-stage ns/frame:\n");
+  for (int i = 0; i < StageCount; i++) {
+    printf("  %-14s %10.1f\n", stageNames[i], (double)timer.totalNs[i] / frames);
+  }
+  printf("decision transitions: %d\n", transitions);
+  return 0;
+}
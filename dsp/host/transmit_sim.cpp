@@ -0,0 +1,351 @@
+// Drives the telemetry Transmitter against a local stand-in HTTP server over
+// a real keep-alive TCP connection, with a simulated WiFi outage and
+// intermittent server errors, then checks every batch arrived once, in order.
+//
+//   transmit_sim [--seconds S] [--batch-ms MS] [--outage-at S] [--outage-s S]
+//                [--fail-pct P] [--rtt-ms MS] [--spool PATH] [--spool-kb K]
+//
+// Batches are produced every --batch-ms (default 100, ten times the firmware
+// rate, to compress the run). The link is down from --outage-at for
+// --outage-s seconds; --fail-pct of requests get a 503, and every answer
+// takes --rtt-ms. The spool holds --spool-kb KiB (default 256, as on the
+// board).
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dsp/file_spool.h"
+#include "dsp/pipeline.h"
+#include "dsp/transmit.h"
+
+using namespace leakdsp;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+class SteadyMsClock : public Clock {
+public:
+  SteadyMsClock() : epoch_(SteadyClock::now()) {}
+  uint32_t nowMs() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::now() - epoch_).count();
+  }
+
+private:
+  SteadyClock::time_point epoch_;
+};
+
+static bool readLine(int fd, std::string& line) {
+  line.clear();
+  char c;
+  while (read(fd, &c, 1) == 1) {
+    if (c == '\n') return true;
+    if (c != '\r') line += c;
+  }
+  return false;
+}
+
+static bool readExact(int fd, uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(fd, data, size);
+    if (n <= 0) return false;
+    data += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+  const char* p = (const char*)data;
+  while (size > 0) {
+    ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+// Minimal HTTP/1.1 server standing in for backend/server.js: accepts POSTs on
+// keep-alive connections and records each frame's base time.
+class StandInServer {
+public:
+  StandInServer(int failPct, int rttMs)
+      : failPct_(failPct), rttMs_(rttMs), listener_(-1), port_(0), connections_(0), rng_(11) {}
+
+  bool start() {
+    listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener_, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener_, 4) != 0) return false;
+    socklen_t length = sizeof(addr);
+    getsockname(listener_, (sockaddr*)&addr, &length);
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread([this]() { acceptLoop(); });
+    return true;
+  }
+
+  void stop() {
+    shutdown(listener_, SHUT_RDWR);
+    close(listener_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < clients_.size(); i++) shutdown(clients_[i], SHUT_RDWR);
+    }
+    thread_.join();
+  }
+
+  int port() const { return port_; }
+  int connections() const { return connections_.load(); }
+
+  std::vector<uint32_t> received() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return received_;
+  }
+
+private:
+  void acceptLoop() {
+    std::vector<std::thread> clients;
+    for (;;) {
+      int fd = accept(listener_, 0, 0);
+      if (fd < 0) break;
+      connections_++;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        clients_.push_back(fd);
+      }
+      clients.push_back(std::thread([this, fd]() { serve(fd); }));
+    }
+    for (size_t i = 0; i < clients.size(); i++) clients[i].join();
+  }
+
+  void serve(int fd) {
+    std::string line;
+    std::vector<uint8_t> body;
+    while (readLine(fd, line)) {
+      size_t contentLength = 0;
+      while (readLine(fd, line) && !line.empty()) {
+        if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) contentLength = strtoul(line.c_str() + 15, 0, 10);
+      }
+      body.resize(contentLength);
+      if (!readExact(fd, body.data(), contentLength)) break;
+
+      bool fail;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uniform_int_distribution<int> roll(0, 99);
+        fail = roll(rng_) < failPct_;
+        if (!fail && contentLength >= (size_t)telemetryHeaderBytes) {
+          received_.push_back((uint32_t)body[5] | (uint32_t)body[6] << 8 | (uint32_t)body[7] << 16 |
+                              (uint32_t)body[8] << 24);
+        }
+      }
+      if (rttMs_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(rttMs_));
+      const char* response = fail ? "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n"
+                                  : "HTTP/1.1 200 OK\r\nContent-Length: 16\r\n\r\n{\"success\":true}";
+      if (!writeAll(fd, response, strlen(response))) break;
+    }
+    close(fd);
+  }
+
+  int failPct_;
+  int rttMs_;
+  int listener_;
+  int port_;
+  std::atomic<int> connections_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::mt19937 rng_;
+  std::vector<uint32_t> received_;
+  std::vector<int> clients_;
+};
+
+// Keep-alive HTTP client, the host counterpart of the firmware's HTTPClient
+// with setReuse(true). linkUp stands in for WiFi association.
+class SocketTransport : public Transport {
+public:
+  explicit SocketTransport(int port) : linkUp(true), port_(port), fd_(-1) {}
+  ~SocketTransport() { disconnect(); }
+
+  bool connected() {
+    if (!linkUp) disconnect();
+    return linkUp;
+  }
+
+  int post(const uint8_t* data, size_t size) {
+    if (fd_ < 0 && !connect()) return -1;
+    char header[160];
+    int length = snprintf(header, sizeof(header),
+                          "POST /api/data/batch HTTP/1.1\r\nHost: localhost\r\n"
+                          "Content-Type: application/octet-stream\r\nContent-Length: %u\r\n\r\n",
+                          (unsigned)size);
+    if (!writeAll(fd_, header, (size_t)length) || !writeAll(fd_, data, size)) return fail();
+
+    std::string line;
+    if (!readLine(fd_, line) || line.size() < 12) return fail();
+    int status = atoi(line.c_str() + 9);
+    size_t contentLength = 0;
+    while (readLine(fd_, line) && !line.empty()) {
+      if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) contentLength = strtoul(line.c_str() + 15, 0, 10);
+    }
+    std::vector<uint8_t> body(contentLength);
+    if (!readExact(fd_, body.data(), contentLength)) return fail();
+    return status;
+  }
+
+  std::atomic<bool> linkUp;
+
+private:
+  bool connect() {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port_);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd_, (sockaddr*)&addr, sizeof(addr)) != 0) {
+      disconnect();
+      return false;
+    }
+    return true;
+  }
+
+  int fail() {
+    disconnect();
+    return -1;
+  }
+
+  void disconnect() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+  }
+
+  int port_;
+  int fd_;
+};
+
+int main(int argc, char** argv) {
+  int seconds = 8;
+  int batchMs = 100;
+  int outageAt = 2;
+  int outageS = 3;
+  int failPct = 10;
+  int rttMs = 0;
+  const char* spoolPath = "transmit_sim.spool";
+  int spoolKb = 256;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--batch-ms") == 0 && i + 1 < argc) batchMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--outage-at") == 0 && i + 1 < argc) outageAt = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--outage-s") == 0 && i + 1 < argc) outageS = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--fail-pct") == 0 && i + 1 < argc) failPct = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--rtt-ms") == 0 && i + 1 < argc) rttMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--spool") == 0 && i + 1 < argc) spoolPath = argv[++i];
+    else if (strcmp(argv[i], "--spool-kb") == 0 && i + 1 < argc) spoolKb = atoi(argv[++i]);
+    else {
+      fprintf(stderr,
+              "usage: %s [--seconds S] [--batch-ms MS] [--outage-at S] [--outage-s S] [--fail-pct P] [--rtt-ms MS]"
+              " [--spool PATH] [--spool-kb K]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  StandInServer server(failPct, rttMs);
+  if (!server.start()) {
+    fprintf(stderr, "cannot start stand-in server\n");
+    return 1;
+  }
+
+  remove(spoolPath);
+  FileSpool spool(spoolPath, (uint32_t)spoolKb * 1024);
+  if (!spool.open()) {
+    fprintf(stderr, "cannot open spool %s\n", spoolPath);
+    return 1;
+  }
+
+  SteadyMsClock clock;
+  SocketTransport transport(server.port());
+  Transmitter transmitter(transport, spool, clock);
+  std::atomic<bool> producing(true);
+
+  // Transmit task: polls until the producer is done and everything drained
+  std::thread sender([&]() {
+    for (;;) {
+      transmitter.poll();
+      TransmitStats s = transmitter.stats();
+      if (!producing && s.queueDepth == 0 && s.spoolDepth == 0) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  // Network task: one batch of telemetryBatchRecords records per batchMs
+  uint32_t produced = 0;
+  uint32_t deviceMs = 0;
+  SteadyClock::time_point start = SteadyClock::now();
+  SteadyClock::time_point next = start;
+  SteadyClock::time_point end = start + std::chrono::seconds(seconds);
+  TelemetryBatch batch;
+  TelemetryRecord record;
+  memset(&record, 0, sizeof(record));
+  record.burstType = BurstTypeNormalFlow;
+  record.locationKind = LocationNone;
+  while (next < end) {
+    double t = std::chrono::duration<double>(SteadyClock::now() - start).count();
+    transport.linkUp = !(t >= outageAt && t < outageAt + outageS);
+
+    batch.clear();
+    for (int i = 0; i < telemetryBatchRecords; i++) {
+      record.timeMs = deviceMs;
+      for (int s = 0; s < numSensors; s++) record.values[s] = 30 + (int)((deviceMs / 100 + s) % 7);
+      batch.add(record);
+      deviceMs += telemetryWindowMs;
+    }
+    transmitter.enqueue(batch);
+    produced++;
+    next += std::chrono::milliseconds(batchMs);
+    std::this_thread::sleep_until(next);
+  }
+  transport.linkUp = true;
+  producing = false;
+  sender.join();
+  server.stop();
+
+  TransmitStats s = transmitter.stats();
+  std::vector<uint32_t> received = server.received();
+  bool ordered = true;
+  for (size_t i = 1; i < received.size(); i++) {
+    if (received[i] <= received[i - 1]) ordered = false;
+  }
+
+  printf("produced %u batches over %d s, link down %d-%d s, %d%% server errors\n", produced, seconds, outageAt,
+         outageAt + outageS, failPct);
+  printf("transmitter: %u enqueued, %u dropped, %u sent (%u replayed from spool), %u spooled, "
+         "%u failed attempts, %u rejected\n",
+         s.enqueued, s.dropped, s.sent, s.replayed, s.spooled, s.failures, s.rejected);
+  printf("latency (queue path): last %u ms, max %u ms\n", s.lastLatencyMs, s.maxLatencyMs);
+  printf("server: %zu batches over %d connections, %s\n", received.size(), server.connections(),
+         ordered ? "in order" : "OUT OF ORDER");
+  bool complete = received.size() + s.dropped + s.rejected == produced;
+  printf("%s\n", complete && ordered ? "OK: every batch delivered once, in order" : "FAIL");
+  remove(spoolPath);
+  return complete && ordered ? 0 : 1;
+}
@@ -0,0 +1,814 @@
+#ifndef LEAKDSP_LEAK_DETECTOR_H
+#define LEAKDSP_LEAK_DETECTOR_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "detector_config.h"
+#include "goertzel.h"
+#include "platform.h"
+#include "rolling_stats.h"
+#include "sample_traits.h"
+#include "tdoa.h"
+
+// Multi-sensor leak/burst detector, free of Arduino dependencies. The firmware
+// feeds it analogRead() frames; the host build replays recorded traces.
+// BasicLeakDetector is instantiated with FloatTraits (reference) or
+// FixedTraits (integer per-frame path) and a sensor count; LeakDetector is
+// the fixed one over numSensors sensors spaced sensorSpacingM apart.
+
+namespace leakdsp {
+
+inline int imax(int a, int b) { return a > b ? a : b; }
+inline int imin(int a, int b) { return a < b ? a : b; }
+inline int iabs(int a) { return a < 0 ? -a : a; }
+inline float fmax1(float a) { return a > 1.0f ? a : 1.0f; }
+
+inline void copyText(char* destination, const char* source, size_t size) {
+  strncpy(destination, source, size - 1);
+  destination[size - 1] = '\0';
+}
+
+const int amplitudeHistorySize = 15;
+
+// Enhanced sensor data, structure-of-arrays: each field holds every sensor.
+template <typename Traits, int S>
+struct PrecisionSensorBank {
+  typedef typename Traits::Sample Sample;
+
+  WindowBank<S, signalWindow, Sample> signal;   // recent readings, one row per frame
+  RollingWindow<noiseWindow, Sample> noise[S];  // quiet-period baselines, advance independently
+  typename Traits::Level amplitudeHistory[S][amplitudeHistorySize];
+  int ampIndex[S];
+
+  // Advanced filtering (variances in DetectorMath<Traits> units)
+  int consecutiveLeak[S], consecutiveBurst[S], consecutiveCatastrophic[S];
+  typename Traits::Stat signalVariance[S], amplitudeVariance[S];
+  uint32_t leakStartTime[S], lastHighVibration[S];
+  bool inLeakState[S], inBurstState[S], inCatastrophicState[S];
+  bool signalStable[S];
+
+  // Burst-specific metrics
+  float burstFrequency[S];
+  int bandRatioQ8[S];  // burst band / reference band power, or spectrumUnavailable
+  int bandRms[S];      // RMS of the burst band in ADC counts, from the last estimate
+};
+
+// Per-frame statistics of the detector in the two representations.
+template <typename Traits>
+struct DetectorMath;
+
+// Reference: float statistics and libm, as originally written.
+template <>
+struct DetectorMath<FloatTraits> {
+  typedef FloatTraits::Stat Stat;
+  typedef FloatTraits::Score Score;
+
+  typedef float Spread;
+
+  // Standard deviation of the noise window about noiseAvg
+  template <typename Window>
+  static Spread spread(const Window& noise, int noiseAvg) {
+    return sqrtf(noise.varianceAbout(noiseAvg));
+  }
+
+  // max(base, noiseAvg + sigma * spread)
+  static int sigmaThreshold(int base, int noiseAvg, Spread noiseStdDev, Ratio sigma) {
+    return imax(base, (int)(noiseAvg + noiseStdDev * sigma.value));
+  }
+
+  template <typename Window>
+  static Stat variance(const Window& window, int mean) { return window.varianceAbout(mean); }
+
+  template <typename Window>
+  static bool stable(Stat variance, const Window&, int mean) {
+    return variance / fmax1((float)mean) < signalStabilityThreshold;
+  }
+
+  static float level(int mean) { return (float)mean; }
+
+  static Stat amplitudeVariance(const float* history) {
+    float ampMean = 0;
+    for (int i = 0; i < amplitudeHistorySize; i++) ampMean += history[i];
+    ampMean /= amplitudeHistorySize;
+
+    float variance = 0;
+    for (int i = 0; i < amplitudeHistorySize; i++) {
+      float diff = history[i] - ampMean;
+      variance += diff * diff;
+    }
+    return variance / amplitudeHistorySize;
+  }
+
+  static bool amplitudeConsistent(Stat variance, int mean) { return variance < (mean * amplitudeConsistency); }
+
+  // value / max(1, reference) > limit
+  static bool ratioAbove(int value, int reference, Ratio limit) {
+    return value / fmax1((float)reference) > limit.value;
+  }
+
+  template <int C, int N, typename T>
+  static void correlations(const RollingCoMoments<C>& moments, const WindowBank<C, N, T>& bank, Score* out) {
+    moments.correlationMatrix(bank, out);
+  }
+
+  static float toFloat(Score score) { return score; }
+  static Score magnitude(Score score) { return fabsf(score); }
+  static bool scoreBelow(Score score, Ratio limit) { return score < limit.value; }
+
+  // Mean absolute correlation over the pairs
+  static bool agree(const Score* scores, int count) { return meanAbs(scores, count) > sensorAgreementThreshold; }
+  static int agreementScore(const Score* scores, int count) { return (int)(meanAbs(scores, count) * 100); }
+
+private:
+  static float meanAbs(const Score* scores, int count) {
+    float sum = 0;
+    for (int p = 0; p < count; p++) sum += fabsf(scores[p]);
+    return sum / count;
+  }
+};
+
+// Integer: variances are kept as count * variance (signal) and
+// amplitudeHistorySize^2 * variance (amplitudes), so every comparison is an
+// exact cross-multiplication against a Q16 constant.
+template <>
+struct DetectorMath<FixedTraits> {
+  typedef FixedTraits::Stat Stat;
+  typedef FixedTraits::Score Score;
+
+  typedef int32_t Spread;  // standard deviation, Q8
+
+  // One integer square root per sensor and frame, shared by the three thresholds
+  template <typename Window>
+  static Spread spread(const Window& noise, int noiseAvg) {
+    if (noise.count() < 2) return 0;
+    return (Spread)isqrt64(((uint64_t)noise.squaredDeviation(noiseAvg) << 16) / (uint64_t)noise.count());
+  }
+
+  static int sigmaThreshold(int base, int noiseAvg, Spread noiseStdDevQ8, Ratio sigma) {
+    return imax(base, noiseAvg + (int)(((int64_t)noiseStdDevQ8 * sigma.q16) >> 24));
+  }
+
+  template <typename Window>
+  static Stat variance(const Window& window, int mean) {
+    return window.count() < 2 ? 0 : window.squaredDeviation(mean);
+  }
+
+  template <typename Window>
+  static bool stable(Stat variance, const Window& window, int mean) {
+    return (variance << 16) < (int64_t)stabilityLimit.q16 * window.count() * imax(1, mean);
+  }
+
+  static int16_t level(int mean) { return (int16_t)mean; }
+
+  static Stat amplitudeVariance(const int16_t* history) {
+    int64_t sum = 0, sumSquares = 0;
+    for (int i = 0; i < amplitudeHistorySize; i++) {
+      sum += history[i];
+      sumSquares += (int64_t)history[i] * history[i];
+    }
+    return amplitudeHistorySize * sumSquares - sum * sum;
+  }
+
+  static bool amplitudeConsistent(Stat variance, int mean) {
+    return (variance << 16) < (int64_t)amplitudeLimit.q16 * amplitudeHistorySize * amplitudeHistorySize * mean;
+  }
+
+  static bool ratioAbove(int value, int reference, Ratio limit) {
+    return ((int64_t)value << 16) > (int64_t)limit.q16 * imax(1, reference);
+  }
+
+  template <int C, int N, typename T>
+  static void correlations(const RollingCoMoments<C>& moments, const WindowBank<C, N, T>& bank, Score* out) {
+    moments.correlationMatrixQ14(bank, out);
+  }
+
+  static float toFloat(Score score) { return score * (1.0f / (1 << correlationShift)); }
+  static Score magnitude(Score score) { return iabs(score); }
+  // Q14 score against a Q16 limit
+  static bool scoreBelow(Score score, Ratio limit) { return (int64_t)score * 4 < limit.q16; }
+
+  // sum / count > limit with Q14 scores against a Q16 limit
+  static bool agree(const Score* scores, int count) {
+    return sumAbs(scores, count) * 4 > count * (int64_t)agreementLimit.q16;
+  }
+  static int agreementScore(const Score* scores, int count) {
+    return (int)(sumAbs(scores, count) * 100 / ((int64_t)count << correlationShift));
+  }
+
+private:
+  static int64_t sumAbs(const Score* scores, int count) {
+    int64_t sum = 0;
+    for (int p = 0; p < count; p++) sum += iabs(scores[p]);
+    return sum;
+  }
+};
+
+// Multi-sensor correlation over S sensors along one main. Pair scores stay in
+// the detector's representation; pairCorrelation() converts one for reports.
+template <typename Traits, int S>
+struct BasicSensorCorrelation {
+  typedef typename Traits::Score Score;
+  static const int pairs = S * (S - 1) / 2;
+  static const int segments = S - 1;  // adjacent pairs (k, k + 1)
+
+  Score correlation[pairs];     // every pair, at RollingCoMoments<S>::pairIndex(i, j)
+  float timeDelay[segments];    // ms, sensor k minus sensor k + 1
+  float peak[segments];         // cross-correlation at the delay
+  bool sensorsAgree;
+  int agreementScore;
+
+  Score pairScore(int i, int j) const { return correlation[RollingCoMoments<S>::pairIndex(i, j)]; }
+  float pairCorrelation(int i, int j) const { return DetectorMath<Traits>::toFloat(pairScore(i, j)); }
+};
+
+typedef BasicSensorCorrelation<FixedTraits, numSensors> SensorCorrelation;
+
+// What the location text describes; sent instead of the text (see telemetry_codec.h).
+enum LocationKind {
+  LocationNone,        // "No leak detected"
+  LocationNoActivity,  // "No activity detected"
+  LocationIsolated,    // "Isolated sensor activity - possible false positive"
+  LocationNear,        // "Near Sensor a - <section>"
+  LocationBetween,     // "Between Sensor a and Sensor b - <section>"
+  LocationSegment,     // "Between Sensor a and Sensor a+1 - x m from Sensor a"
+  LocationEitherEnd,   // "Near Sensor 1 or Sensor <last> - Pipeline Junction Area"
+  LocationMultiple,    // "Multiple sensors - Pipeline section affected"
+  LocationUnknown,     // "Unknown location"
+  LocationKindCount
+};
+
+// Leak detection state
+struct LeakDetectionState {
+  bool confirmed;
+  char location[96];     // room for the longest text with any int sensor numbers
+  LocationKind locationKind;
+  int locationSensor;     // first sensor of the located pair or segment, -1 if none
+  int locationPeer;       // second sensor of the located pair or segment, -1 if none
+  float positionM;        // estimated leak position from locationSensor
+  int primarySensor;
+  int confidence;         // percent
+  uint32_t detectionTime;
+  int stabilityScore;
+  bool environmentalNoise;
+  const char* burstType;  // "PIPELINE LEAK", "PIPELINE BURST", "CATASTROPHIC BURST"
+  int burstIntensity10;   // mean level of the active sensors, tenths of an ADC count
+  float burstFrequency;   // dominant burst band frequency of the primary sensor
+};
+
+// Adaptive thresholds of one sensor, from its noise baseline.
+struct Thresholds {
+  int leak;
+  int burst;
+  int catastrophic;
+};
+
+// Outcome of one processed frame.
+struct Decision {
+  uint32_t timeMs;
+  bool leakConfirmed;
+  bool burstConfirmed;
+  bool catastrophicConfirmed;
+  int activeSensors;
+  int strongestSensor;
+};
+
+template <typename Traits, int Sensors = numSensors>
+class BasicLeakDetector {
+public:
+  typedef PrecisionSensorBank<Traits, Sensors> SensorBank;
+  typedef BasicSensorCorrelation<Traits, Sensors> Correlation;
+  typedef DetectorMath<Traits> Math;
+  typedef typename Traits::Score Score;
+  static const int sensorCount = Sensors;
+
+  explicit BasicLeakDetector(Clock& clock) : clock_(clock), observer_(0) { reset(); }
+
+  void setObserver(StageObserver* observer) { observer_ = observer; }
+
+  void reset() {
+    sensors_.signal.clear();
+    for (int s = 0; s < Sensors; s++) {
+      sensors_.noise[s].clear();
+      for (int i = 0; i < amplitudeHistorySize; i++) sensors_.amplitudeHistory[s][i] = 0;
+
+      sensors_.ampIndex[s] = 0;
+      sensors_.consecutiveLeak[s] = 0;
+      sensors_.consecutiveBurst[s] = 0;
+      sensors_.consecutiveCatastrophic[s] = 0;
+      sensors_.signalVariance[s] = 0;
+      sensors_.amplitudeVariance[s] = 0;
+      sensors_.leakStartTime[s] = 0;
+      sensors_.lastHighVibration[s] = 0;
+      sensors_.inLeakState[s] = false;
+      sensors_.inBurstState[s] = false;
+      sensors_.inCatastrophicState[s] = false;
+      sensors_.signalStable[s] = false;
+      sensors_.burstFrequency[s] = 0;
+      sensors_.bandRatioQ8[s] = spectrumUnavailable;
+      sensors_.bandRms[s] = 0;
+    }
+    spectralHop_ = 0;
+    windowStartMs_ = 0;
+
+    for (int p = 0; p < Correlation::pairs; p++) sensorCorr_.correlation[p] = 0;
+    for (int k = 0; k < Correlation::segments; k++) sensorCorr_.timeDelay[k] = sensorCorr_.peak[k] = 0;
+    sensorCorr_.sensorsAgree = false;
+    sensorCorr_.agreementScore = 0;
+
+    leakState_.confirmed = false;
+    copyText(leakState_.location, "No leak detected", sizeof(leakState_.location));
+    leakState_.locationKind = LocationNone;
+    leakState_.locationSensor = -1;
+    leakState_.locationPeer = -1;
+    leakState_.positionM = 0;
+    leakState_.primarySensor = -1;
+    leakState_.confidence = 0;
+    leakState_.detectionTime = 0;
+    leakState_.stabilityScore = 0;
+    leakState_.environmentalNoise = false;
+    leakState_.burstType = "NORMAL";
+    leakState_.burstIntensity10 = 0;
+    leakState_.burstFrequency = 0;
+
+    decision_.timeMs = 0;
+    decision_.leakConfirmed = false;
+    decision_.burstConfirmed = false;
+    decision_.catastrophicConfirmed = false;
+    decision_.activeSensors = 0;
+    decision_.strongestSensor = -1;
+    coMoments_.clear();
+  }
+
+  // Boot calibration: feed calibrationSamples frames into the noise baselines.
+  void addCalibrationSample(const int* samples) {
+    for (int s = 0; s < Sensors; s++) sensors_.noise[s].push(samples[s]);
+  }
+
+  int average(int s) const { return sensors_.signal.mean(s); }
+
+  // The last signalWindow frames, one row per frame.
+  const WindowBank<Sensors, signalWindow, typename SensorBank::Sample>& signalWindows() const {
+    return sensors_.signal;
+  }
+
+  // Burst band RMS of sensor s over the last spectral window.
+  int bandRms(int s) const { return sensors_.bandRms[s]; }
+
+  // True right after the frame that completed a spectral window, so per-window
+  // summaries line up with the band estimate.
+  bool windowComplete() const { return spectralHop_ == 0; }
+  int noiseBaseline(int s) const { return sensors_.noise[s].mean(); }
+
+  // Thresholds the next frame of sensor s is compared against.
+  Thresholds thresholds(int s) const {
+    const RollingWindow<noiseWindow, typename SensorBank::Sample>& noise = sensors_.noise[s];
+    int noiseAvg = noise.mean();
+    typename Math::Spread noiseStdDev = Math::spread(noise, noiseAvg);
+    Thresholds t;
+    t.leak = Math::sigmaThreshold(leakThreshold, noiseAvg, noiseStdDev, leakSigma);
+    t.burst = Math::sigmaThreshold(burstThreshold, noiseAvg, noiseStdDev, burstSigma);
+    t.catastrophic = Math::sigmaThreshold(catastrophicBurstThreshold, noiseAvg, noiseStdDev, catastrophicSigma);
+    return t;
+  }
+
+  // Noise baseline of sensor s for the calibration snapshot (calibration.h).
+  const RollingWindow<noiseWindow, typename SensorBank::Sample>& noiseWindowOf(int s) const {
+    return sensors_.noise[s];
+  }
+
+  // Warm start: refills the noise baseline from saved statistics (x16). Live
+  // quiet-period samples displace the synthetic ones as usual.
+  void restoreNoiseBaseline(int s, int32_t meanQ4, uint32_t varianceQ4) { sensors_.noise[s].seed(meanQ4, varianceQ4); }
+
+  // Reads one frame from the source and processes it. Returns false when the
+  // source is exhausted.
+  bool step(SampleSource& source) {
+    int samples[Sensors];
+    if (!source.read(samples, Sensors)) return false;
+    process(samples);
+    return true;
+  }
+
+  const Decision& process(const int* samples) { return processAt(samples, clock_.nowMs()); }
+
+  // Processes a frame sampled at currentMillis (queued frames carry their own
+  // acquisition time).
+  const Decision& processAt(const int* samples, uint32_t currentMillis) {
+
+    // Read all sensors with precision processing
+    bool anyLeakDetected = false;
+    bool anyBurstDetected = false;
+    bool anyCatastrophicDetected = false;
+    int strongestSensor = -1;
+    int strongestReading = 0;
+    int activeLeakSensors = 0;
+    int totalBurstIntensity = 0;
+    int evicted[Sensors];
+
+    // Update moving averages, one frame row for every sensor
+    sensors_.signal.push(samples, evicted);
+
+    for (int s = 0; s < Sensors; s++) {
+      int sensorValue = samples[s];
+      int avgValue = sensors_.signal.mean(s);
+      RollingWindow<noiseWindow, typename SensorBank::Sample>& noise = sensors_.noise[s];
+
+      // Update noise baseline (only during quiet periods)
+      if (avgValue < noise.mean() + 30) {
+        noise.push(sensorValue);
+      }
+      notify(StageIngest);
+
+      // Calculate adaptive thresholds for municipal environment
+      Thresholds adaptive = thresholds(s);
+      notify(StageThresholds);
+
+      // 🎯 PRECISION FILTERING FOR MUNICIPAL PIPELINES
+      bool isNoise = isEnvironmentalNoise(s, currentMillis);
+      bool hasPattern = detectBurstPattern(s);
+      notify(StageFilters);
+
+      bool aboveLeakThreshold = (avgValue > adaptive.leak);
+      bool aboveBurstThreshold = (avgValue > adaptive.burst);
+      bool aboveCatastrophicThreshold = (avgValue > adaptive.catastrophic);
+
+      // Combined precision detection for municipal conditions
+      bool precisionLeak = aboveLeakThreshold && !isNoise && hasPattern;
+      bool precisionBurst = aboveBurstThreshold && !isNoise && hasPattern;
+      bool precisionCatastrophic = aboveCatastrophicThreshold && !isNoise && hasPattern;
+
+      int& consecutiveLeak = sensors_.consecutiveLeak[s];
+      int& consecutiveBurst = sensors_.consecutiveBurst[s];
+      int& consecutiveCatastrophic = sensors_.consecutiveCatastrophic[s];
+
+      // Consecutive reading logic with burst-specific requirements
+      if (precisionCatastrophic) {
+        consecutiveCatastrophic++;
+        consecutiveBurst++;
+        consecutiveLeak++;
+      } else if (precisionBurst) {
+        consecutiveBurst++;
+        consecutiveLeak++;
+        consecutiveCatastrophic = 0;
+      } else if (precisionLeak) {
+        consecutiveLeak++;
+        consecutiveBurst = 0;
+        consecutiveCatastrophic = 0;
+      } else {
+        consecutiveLeak = imax(0, consecutiveLeak - 1);
+        consecutiveBurst = 0;
+        consecutiveCatastrophic = 0;
+      }
+
+      // State management with burst-specific duration validation
+      bool sensorLeakDetected = (consecutiveLeak >= requiredConsecutive);
+      bool sensorBurstDetected = (consecutiveBurst >= requiredConsecutive);
+      bool sensorCatastrophicDetected = (consecutiveCatastrophic >= catastrophicConsecutive);
+
+      uint32_t& leakStartTime = sensors_.leakStartTime[s];
+      bool& inLeakState = sensors_.inLeakState[s];
+      bool& inBurstState = sensors_.inBurstState[s];
+      bool& inCatastrophicState = sensors_.inCatastrophicState[s];
+
+      if (sensorCatastrophicDetected) {
+        if (!inCatastrophicState) {
+          leakStartTime = currentMillis;
+          inCatastrophicState = true;
+        }
+        if (currentMillis - leakStartTime >= (uint32_t)burstResponseTime) {
+          anyCatastrophicDetected = true;
+          anyBurstDetected = true;
+          anyLeakDetected = true;
+          activeLeakSensors++;
+          totalBurstIntensity += avgValue;
+        }
+      } else if (sensorBurstDetected) {
+        if (!inBurstState) {
+          leakStartTime = currentMillis;
+          inBurstState = true;
+        }
+        if (currentMillis - leakStartTime >= (uint32_t)burstResponseTime) {
+          anyBurstDetected = true;
+          anyLeakDetected = true;
+          activeLeakSensors++;
+          totalBurstIntensity += avgValue;
+        }
+        inCatastrophicState = false;
+      } else if (sensorLeakDetected) {
+        if (!inLeakState) {
+          leakStartTime = currentMillis;
+          inLeakState = true;
+        }
+        if (currentMillis - leakStartTime >= (uint32_t)minLeakDuration) {
+          anyLeakDetected = true;
+          activeLeakSensors++;
+          totalBurstIntensity += avgValue;
+        }
+        inBurstState = false;
+        inCatastrophicState = false;
+      } else {
+        inLeakState = false;
+        inBurstState = false;
+        inCatastrophicState = false;
+      }
+
+      if (avgValue > strongestReading) {
+        strongestReading = avgValue;
+        strongestSensor = s;
+      }
+      notify(StageStateMachine);
+    }
+
+    // 🎯 MULTI-SENSOR PRECISION VALIDATION FOR MUNICIPAL PIPELINES
+    updateSpectrum(currentMillis);
+    notify(StageSpectral);
+
+    coMoments_.update(samples, evicted);
+    updateSensorCorrelations();
+    notify(StageCorrelation);
+
+    // Final leak confirmation with municipal-specific validation
+    bool finalLeakConfirmed = false;
+    bool finalBurstConfirmed = false;
+    bool finalCatastrophicConfirmed = false;
+
+    if (anyLeakDetected || anyBurstDetected || anyCatastrophicDetected) {
+      // Requirement 1: Multiple sensors must agree (for municipal reliability)
+      bool multiSensorAgreement = (activeLeakSensors >= 2) || sensorCorr_.sensorsAgree;
+
+      // Requirement 2: Signal stability across sensors
+      bool signalStability = true;
+      for (int s = 0; s < Sensors; s++) {
+        if (sensors_.inLeakState[s] && !sensors_.signalStable[s]) {
+          signalStability = false;
+          break;
+        }
+      }
+
+      // Requirement 3: Environmental noise check for urban environment
+      bool noEnvironmentalNoise = true;
+      for (int s = 0; s < Sensors; s++) {
+        if (isEnvironmentalNoise(s, currentMillis)) {
+          noEnvironmentalNoise = false;
+          leakState_.environmentalNoise = true;
+          break;
+        }
+      }
+
+      // Final decision with municipal precision filters
+      finalLeakConfirmed = anyLeakDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
+      finalBurstConfirmed = anyBurstDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
+      finalCatastrophicConfirmed = anyCatastrophicDetected && multiSensorAgreement && signalStability && noEnvironmentalNoise;
+
+      if (finalLeakConfirmed || finalBurstConfirmed || finalCatastrophicConfirmed) {
+        // 📍 Delays on a new event, then once per block while it lasts
+        if (!leakState_.confirmed || spectralHop_ == 0) updateTimeDelays();
+        leakState_.confirmed = true;
+        determineLeakLocation();
+        leakState_.primarySensor = strongestSensor;
+        leakState_.confidence = imin(100, sensorCorr_.agreementScore + (signalStability ? 25 : 0));
+        leakState_.detectionTime = currentMillis;
+        leakState_.stabilityScore = signalStability ? 100 : 50;
+        int sensors = imax(1, activeLeakSensors);
+        leakState_.burstIntensity10 = (totalBurstIntensity * 20 + sensors) / (2 * sensors);  // rounded
+
+        // Burst classes also need their vibration energy in the burst band
+        int bandRatio = strongestSensor >= 0 ? sensors_.bandRatioQ8[strongestSensor] : spectrumUnavailable;
+        leakState_.burstType = determineBurstType(finalCatastrophicConfirmed, finalBurstConfirmed, bandRatio);
+        leakState_.burstFrequency = strongestSensor >= 0 ? sensors_.burstFrequency[strongestSensor] : 0;
+        finalCatastrophicConfirmed = finalCatastrophicConfirmed && inBurstBand(bandRatio);
+        finalBurstConfirmed = finalBurstConfirmed && inBurstBand(bandRatio);
+      }
+    } else {
+      leakState_.confirmed = false;
+      leakState_.environmentalNoise = false;
+      leakState_.burstType = "NORMAL FLOW";
+      leakState_.burstIntensity10 = 0;
+    }
+
+    decision_.timeMs = currentMillis;
+    decision_.leakConfirmed = finalLeakConfirmed;
+    decision_.burstConfirmed = finalBurstConfirmed;
+    decision_.catastrophicConfirmed = finalCatastrophicConfirmed;
+    decision_.activeSensors = activeLeakSensors;
+    decision_.strongestSensor = strongestSensor;
+    notify(StageDecision);
+    return decision_;
+  }
+
+  const SensorBank& sensors() const { return sensors_; }
+  const Correlation& correlation() const { return sensorCorr_; }
+  const LeakDetectionState& leakState() const { return leakState_; }
+  const Decision& decision() const { return decision_; }
+
+  // True when the band ratio supports a burst. Without a spectral estimate
+  // (frames off sampleRateHz, window not yet full) amplitude alone decides.
+  static bool inBurstBand(int bandRatioQ8) {
+    return bandRatioQ8 == spectrumUnavailable || bandRatioQ8 >= burstBandRatioQ8;
+  }
+
+  // Labels a confirmed event from the amplitude verdicts and the band ratio.
+  static const char* determineBurstType(bool catastrophic, bool burst, int bandRatioQ8) {
+    if (catastrophic && inBurstBand(bandRatioQ8)) {
+      return "CATASTROPHIC BURST";
+    } else if (burst && inBurstBand(bandRatioQ8)) {
+      return "PIPELINE BURST";
+    } else {
+      return "PIPELINE LEAK";
+    }
+  }
+
+  const BandEnergyAnalyzer& spectralAnalyzer() const { return spectral_; }
+
+private:
+  // 🧮 ADVANCED CALCULATION FUNCTIONS
+
+  bool detectBurstPattern(int sensorIndex) {
+    typename WindowBank<Sensors, signalWindow, typename SensorBank::Sample>::Channel signal =
+        sensors_.signal.channel(sensorIndex);
+
+    // 1. Check signal stability for burst conditions
+    int avgValue = signal.mean();
+    typename Traits::Stat& signalVariance = sensors_.signalVariance[sensorIndex];
+    signalVariance = Math::variance(signal, avgValue);
+    bool stable = Math::stable(signalVariance, signal, avgValue);
+    sensors_.signalStable[sensorIndex] = stable;
+
+    // 2. Amplitude consistency check for burst signature
+    if (avgValue > leakThreshold) {
+      int& ampIndex = sensors_.ampIndex[sensorIndex];
+      sensors_.amplitudeHistory[sensorIndex][ampIndex] = Math::level(avgValue);
+      ampIndex = (ampIndex + 1) % amplitudeHistorySize;
+
+      if (ampIndex == 0) { // Calculate amplitude variance every 15 readings
+        sensors_.amplitudeVariance[sensorIndex] = Math::amplitudeVariance(sensors_.amplitudeHistory[sensorIndex]);
+      }
+    }
+
+    // 3. Burst pattern consistency scoring
+    bool patternConsistent = stable && Math::amplitudeConsistent(sensors_.amplitudeVariance[sensorIndex], avgValue);
+
+    return patternConsistent;
+  }
+
+  bool isEnvironmentalNoise(int sensorIndex, uint32_t currentTime) {
+    uint32_t& lastHighVibration = sensors_.lastHighVibration[sensorIndex];
+
+    // 1. Recent high vibration check (extended cooldown for urban environment)
+    if (currentTime - lastHighVibration < (uint32_t)vibrationCooldown) {
+      return true;
+    }
+
+    // 2. Sudden spike detection (environmental noise signature)
+    bool suddenSpike = false;
+    if (sensors_.signal.count() >= 3) {
+      int recent = sensors_.signal.recent(sensorIndex, 0);
+      int previous = sensors_.signal.recent(sensorIndex, 1);
+
+      if (Math::ratioAbove(iabs(recent - previous), previous, spikeRatioLimit)) { // 300% sudden change
+        lastHighVibration = currentTime;
+        suddenSpike = true;
+      }
+    }
+
+    // 3. Signal 15x above baseline = likely noise
+    return suddenSpike ||
+           Math::ratioAbove(sensors_.signal.mean(sensorIndex), sensors_.noise[sensorIndex].mean(), noiseRatioLimit);
+  }
+
+  // Correlation of every pair of full signal windows from the running co-moments.
+  void updateSensorCorrelations() {
+    Score scores[Correlation::pairs];
+    if (sensors_.signal.full()) {
+      Math::correlations(coMoments_, sensors_.signal, scores);
+    } else {
+      for (int p = 0; p < Correlation::pairs; p++) scores[p] = 0;
+    }
+    for (int p = 0; p < Correlation::pairs; p++) sensorCorr_.correlation[p] = scores[p];
+
+    // Calculate agreement score from the mean absolute correlation
+    sensorCorr_.sensorsAgree = Math::agree(scores, Correlation::pairs);
+    sensorCorr_.agreementScore = Math::agreementScore(scores, Correlation::pairs);
+  }
+
+  // Cross-correlation delay of every adjacent pair (FFT based, see tdoa.h).
+  void updateTimeDelays() {
+    const float msPerSample = 1000.0f / sampleRateHz;
+    for (int k = 0; k < Correlation::segments; k++) {
+      DelayEstimate d = tdoa_.estimate(sensors_.signal.channel(k), sensors_.signal.channel(k + 1), maxLagSamples);
+      sensorCorr_.timeDelay[k] = d.valid ? d.lagSamples * msPerSample : 0;
+      sensorCorr_.peak[k] = d.valid ? d.coefficient : 0;
+    }
+  }
+
+  void determineLeakLocation() {
+    // Find strongest correlation to determine location; adjacent pairs win ties
+    int bestFirst = 0, bestSecond = 1;
+    Score maxCorr = -1;
+    for (int gap = 1; gap < Sensors; gap++) {
+      for (int i = 0; i + gap < Sensors; i++) {
+        Score c = Math::magnitude(sensorCorr_.pairScore(i, i + gap));
+        if (c > maxCorr) {
+          maxCorr = c;
+          bestFirst = i;
+          bestSecond = i + gap;
+        }
+      }
+    }
+
+    leakState_.locationSensor = -1;
+    leakState_.locationPeer = -1;
+    leakState_.positionM = 0;
+    if (Math::scoreBelow(maxCorr, locationLimit)) {
+      leakState_.locationKind = LocationIsolated;
+      copyText(leakState_.location, "Isolated sensor activity - possible false positive", sizeof(leakState_.location));
+      return;
+    }
+
+    // Localize on the adjacent segment whose delay estimate is most coherent
+    int segment = 0;
+    for (int k = 1; k < Correlation::segments; k++) {
+      if (fabsf(sensorCorr_.peak[k]) > fabsf(sensorCorr_.peak[segment])) segment = k;
+    }
+    if (fabsf(sensorCorr_.peak[segment]) >= 0.3f) {
+      leakState_.locationKind = LocationSegment;
+      leakState_.locationSensor = segment;
+      leakState_.locationPeer = segment + 1;
+      leakState_.positionM = leakPositionM(sensorCorr_.timeDelay[segment] / 1000.0f, sensorSpacingM, waveSpeedMps);
+      snprintf(leakState_.location, sizeof(leakState_.location),
+               "Between Sensor %d and Sensor %d - %.1f m from Sensor %d",
+               segment + 1, segment + 2, leakState_.positionM, segment + 1);
+      return;
+    }
+
+    // Otherwise name the most correlated pair
+    if (bestFirst == 0 && bestSecond == Sensors - 1 && Sensors > 2) {
+      leakState_.locationKind = LocationEitherEnd;
+      snprintf(leakState_.location, sizeof(leakState_.location),
+               "Near Sensor 1 or Sensor %d - Pipeline Junction Area", Sensors);
+      return;
+    }
+    const char* section = bestSecond != bestFirst + 1 ? "Pipeline Section"
+                          : bestFirst == 0            ? "Main Pipeline Section"
+                          : bestFirst == 1            ? "Secondary Pipeline Section"
+                                                      : "Pipeline Section";
+    leakState_.locationKind = LocationBetween;
+    leakState_.locationSensor = bestFirst;
+    leakState_.locationPeer = bestSecond;
+    snprintf(leakState_.location, sizeof(leakState_.location), "Between Sensor %d and Sensor %d - %s",
+             bestFirst + 1, bestSecond + 1, section);
+  }
+
+  // 📈 Band energy per sensor once every signalWindow frames. The bins assume
+  // sampleRateHz, so blocks that took noticeably longer or shorter are skipped.
+  void updateSpectrum(uint32_t currentMillis) {
+    if (++spectralHop_ < signalWindow) return;
+    spectralHop_ = 0;
+
+    uint32_t expectedMs = (uint32_t)(signalWindow * 1000 / sampleRateHz);
+    uint32_t elapsedMs = currentMillis - windowStartMs_;
+    uint32_t toleranceMs = expectedMs * sampleRateTolerancePct / 100;
+    bool rateMatches = elapsedMs + toleranceMs >= expectedMs && elapsedMs <= expectedMs + toleranceMs;
+    windowStartMs_ = currentMillis;
+
+    for (int s = 0; s < Sensors; s++) {
+      if (rateMatches && sensors_.signal.full()) {
+        BandEnergy energy = spectral_.analyze(sensors_.signal.channel(s));
+        sensors_.bandRatioQ8[s] = energy.ratioQ8;
+        sensors_.burstFrequency[s] = energy.peakHz;
+        // Goertzel power is |X|^2 per bin; the band RMS is sqrt(2 * sum) / N
+        uint64_t power = energy.burst > 0 ? (uint64_t)energy.burst : 0;
+        sensors_.bandRms[s] = (int)((isqrt64(power * 2) + signalWindow / 2) / signalWindow);
+      } else {
+        sensors_.bandRatioQ8[s] = spectrumUnavailable;  // bandRms keeps the last estimate
+      }
+    }
+  }
+
+  void notify(Stage stage) {
+    if (observer_) observer_->stageComplete(stage);
+  }
+
+  Clock& clock_;
+  StageObserver* observer_;
+  SensorBank sensors_;
+  RollingCoMoments<Sensors> coMoments_;
+  BandEnergyAnalyzer spectral_;
+  CrossCorrelator<signalWindow> tdoa_;
+  int spectralHop_;
+  uint32_t windowStartMs_;
+  Correlation sensorCorr_;
+  LeakDetectionState leakState_;
+  Decision decision_;
+};
+
+typedef BasicLeakDetector<FloatTraits> FloatLeakDetector;
+typedef BasicLeakDetector<FixedTraits> FixedLeakDetector;
+typedef FixedLeakDetector LeakDetector;
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_LEAK_DETECTOR_H
@@ -0,0 +1,203 @@
+#ifndef LEAKDSP_PIPELINE_H
+#define LEAKDSP_PIPELINE_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "detector_config.h"
+#include "leak_detector.h"
+#include "platform.h"
+#include "report_by_exception.h"
+#include "spsc_ring.h"
+#include "telemetry_codec.h"
+#include "waveform_capture.h"
+
+// Decoupled acquisition -> analysis -> network pipeline.
+//
+// The acquisition stage samples at a fixed rate into a SampleRing; the
+// analysis stage drains it through the detector and publishes a snapshot with
+// per-sensor window summaries to a TelemetryRing for the network stage, once
+// per detector window and at once on an alarm change. The network stage
+// decides what to send (report_by_exception.h). Each ring has exactly one producer and
+// one consumer, so on the board the stages run as separate FreeRTOS tasks and
+// on the host as std::threads, without locks. With a WaveformUpload attached,
+// the analysis stage also keeps the raw pre/post-trigger capture and hands
+// it over once per detection event.
+
+namespace leakdsp {
+
+const uint32_t sampleRingSize = 256;   // 1.28 s of frames at 200 Hz
+const uint32_t telemetryRingSize = 16;
+const int telemetryWindowMs = signalWindow * 1000 / sampleRateHz;  // one snapshot per detector window
+
+struct SampleFrame {
+  uint32_t sequence;
+  uint32_t timeMs;
+  uint32_t timeUs;  // acquisition timestamp for latency measurement
+  int values[numSensors];
+};
+
+// What the network stage needs from one analysis step.
+struct TelemetrySnapshot {
+  uint32_t sampleSequence;
+  uint32_t sampleTimeUs;
+  int sensorAverage[numSensors];
+  SensorSummary summary[numSensors];
+  Decision decision;
+  LeakDetectionState state;
+  int correlationScore;
+};
+
+// Wire form of a snapshot for the network stage's TelemetryBatch.
+inline TelemetryRecord telemetryRecord(const TelemetrySnapshot& snapshot) {
+  const Decision& decision = snapshot.decision;
+  const LeakDetectionState& state = snapshot.state;
+  TelemetryRecord record;
+  record.timeMs = decision.timeMs;
+  for (int s = 0; s < numSensors; s++) {
+    record.values[s] = snapshot.sensorAverage[s];
+    record.summary[s] = snapshot.summary[s];
+  }
+  record.flags = TelemetrySummary | (decision.leakConfirmed ? TelemetryLeak : 0) |
+                 (decision.burstConfirmed || decision.catastrophicConfirmed ? TelemetryBurst : 0) |
+                 (decision.catastrophicConfirmed ? TelemetryCatastrophic : 0) |
+                 (state.environmentalNoise ? TelemetryEnvironmentalNoise : 0);
+  record.burstType = burstTypeCode(state.burstType);
+  record.locationKind = (uint8_t)state.locationKind;
+  record.locationA = (uint8_t)(state.locationSensor >= 0 ? state.locationSensor : 0);
+  record.locationB = (uint8_t)(state.locationPeer >= 0 ? state.locationPeer : record.locationA + 1);
+  record.positionDm = (uint32_t)(state.positionM * 10 + 0.5f);
+  record.confidence10 = (uint32_t)state.confidence * 10;
+  record.correlationScore = (uint32_t)imax(0, snapshot.correlationScore);
+  record.stabilityScore = (uint32_t)imax(0, state.stabilityScore);
+  record.activeSensors = (uint32_t)imax(0, decision.activeSensors);
+  record.burstIntensity10 = (uint32_t)imax(0, state.burstIntensity10);
+  return record;
+}
+
+typedef SpscRing<SampleFrame, sampleRingSize> SampleRing;
+typedef SpscRing<TelemetrySnapshot, telemetryRingSize> TelemetryRing;
+
+// Producer: one frame per sample() call, paced by the caller.
+class AcquisitionStage {
+public:
+  AcquisitionStage(SampleSource& source, SampleRing& ring)
+      : source_(source), ring_(ring), sequence_(0), dropped_(0) {}
+
+  // Reads a frame and queues it. Returns false when the source is exhausted.
+  // A full ring drops the new frame and counts it.
+  bool sample(uint32_t timeMs, uint32_t timeUs) {
+    SampleFrame frame;
+    if (!source_.read(frame.values, numSensors)) return false;
+    frame.sequence = sequence_++;
+    frame.timeMs = timeMs;
+    frame.timeUs = timeUs;
+    if (!ring_.push(frame)) dropped_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  uint32_t produced() const { return sequence_; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  SampleSource& source_;
+  SampleRing& ring_;
+  uint32_t sequence_;
+  std::atomic<uint32_t> dropped_;
+};
+
+// Consumer of samples, producer of telemetry snapshots.
+class AnalysisStage {
+public:
+  AnalysisStage(LeakDetector& detector, SampleRing& samples, TelemetryRing& telemetry,
+                WaveformUpload* upload = 0)
+      : detector_(detector), samples_(samples), telemetry_(telemetry), upload_(upload),
+        nextSequence_(0), gaps_(0), processed_(0), telemetryDropped_(0), lastAlarm_(0), wasConfirmed_(false),
+        captures_(0), capturesSkipped_(0) {}
+
+  // Processes up to maxFrames queued frames. Returns how many were processed;
+  // `last` receives the most recent frame.
+  int drain(int maxFrames, SampleFrame* last = 0) {
+    int count = 0;
+    SampleFrame frame;
+    while (count < maxFrames && samples_.pop(frame)) {
+      if (frame.sequence != nextSequence_) gaps_ += frame.sequence - nextSequence_;
+      nextSequence_ = frame.sequence + 1;
+
+      detector_.processAt(frame.values, frame.timeMs);
+      processed_++;
+      if (upload_) capture(frame);
+      count++;
+      if (last) *last = frame;
+
+      const Decision& decision = detector_.decision();
+      int alarm = (decision.leakConfirmed ? 1 : 0) | (decision.burstConfirmed ? 2 : 0) |
+                  (decision.catastrophicConfirmed ? 4 : 0);
+      if (detector_.windowComplete() || alarm != lastAlarm_) {
+        lastAlarm_ = alarm;
+        publish(frame);
+      }
+    }
+    return count;
+  }
+
+  uint32_t processed() const { return processed_; }
+  uint32_t gaps() const { return gaps_; }  // frames lost before analysis saw them
+  uint32_t telemetryDropped() const { return telemetryDropped_; }
+  uint32_t captures() const { return captures_; }                // handed to the upload slot
+  uint32_t capturesSkipped() const { return capturesSkipped_; }  // events while a capture was pending
+
+private:
+  void capture(const SampleFrame& frame) {
+    capture_.push(frame.values, frame.timeMs);
+    const LeakDetectionState& state = detector_.leakState();
+    if (state.confirmed && !wasConfirmed_) {
+      if (capture_.triggered()) capturesSkipped_++;
+      capture_.trigger(burstTypeCode(state.burstType));
+    }
+    wasConfirmed_ = state.confirmed;
+
+    // Encode into the slot once the uplink has taken the previous capture
+    if (!capture_.complete() || upload_->ready.load(std::memory_order_acquire)) return;
+    upload_->size = (uint32_t)capture_.encode(upload_->bytes, sizeof(upload_->bytes));
+    if (upload_->size > 0) {
+      upload_->ready.store(true, std::memory_order_release);
+      captures_++;
+    }
+    capture_.rearm();
+  }
+
+  void publish(const SampleFrame& frame) {
+    TelemetrySnapshot snapshot;
+    snapshot.sampleSequence = frame.sequence;
+    snapshot.sampleTimeUs = frame.timeUs;
+    for (int s = 0; s < numSensors; s++) {
+      snapshot.sensorAverage[s] = detector_.average(s);
+      snapshot.summary[s] = summarizeWindow(detector_.signalWindows().channel(s), detector_.bandRms(s));
+    }
+    snapshot.decision = detector_.decision();
+    snapshot.state = detector_.leakState();
+    snapshot.correlationScore = detector_.correlation().agreementScore;
+    // A slow network stage loses snapshots, never samples
+    if (!telemetry_.push(snapshot)) telemetryDropped_++;
+  }
+
+  LeakDetector& detector_;
+  SampleRing& samples_;
+  TelemetryRing& telemetry_;
+  WaveformUpload* upload_;
+  WaveformCapture capture_;
+  uint32_t nextSequence_;
+  uint32_t gaps_;
+  uint32_t processed_;
+  uint32_t telemetryDropped_;
+  int lastAlarm_;  // decision bits at the last snapshot
+  bool wasConfirmed_;
+  uint32_t captures_;
+  uint32_t capturesSkipped_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_PIPELINE_H
@@ -0,0 +1,49 @@
+#ifndef LEAKDSP_PLATFORM_H
+#define LEAKDSP_PLATFORM_H
+
+#include <stdint.h>
+
+// Hardware seams for the detector. The firmware wraps millis()/analogRead(),
+// the host build wraps a recorded trace.
+
+namespace leakdsp {
+
+// Millisecond time source. Differences are taken in uint32_t so wrap-around
+// behaves the same as Arduino millis() on the ESP32.
+class Clock {
+public:
+  virtual ~Clock() {}
+  virtual uint32_t nowMs() = 0;
+};
+
+// Supplies one frame of ADC values, one per sensor. Returns false when no
+// more samples are available (end of a recorded trace).
+class SampleSource {
+public:
+  virtual ~SampleSource() {}
+  virtual bool read(int* values, int count) = 0;
+};
+
+// Processing stages reported to a StageObserver, in the order they run.
+enum Stage {
+  StageIngest,        // moving average and noise baseline update
+  StageThresholds,    // noise variance and adaptive thresholds
+  StageFilters,       // environmental noise and burst pattern checks
+  StageStateMachine,  // consecutive counters and per-sensor state
+  StageSpectral,      // burst band energy, once per signalWindow block
+  StageCorrelation,   // multi-sensor correlation
+  StageDecision,      // final confirmation and leak state update
+  StageCount
+};
+
+// Optional profiling hook, called when each stage finishes. Per-sensor stages
+// are reported once per sensor. Left null on the board.
+class StageObserver {
+public:
+  virtual ~StageObserver() {}
+  virtual void stageComplete(Stage stage) = 0;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_PLATFORM_H
@@ -0,0 +1,126 @@
+#ifndef LEAKDSP_REPORT_BY_EXCEPTION_H
+#define LEAKDSP_REPORT_BY_EXCEPTION_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sample_traits.h"
+#include "telemetry_codec.h"
+
+// Report-by-exception for per-window telemetry summaries.
+//
+// The firmware summarises every window (min/max/mean/RMS and burst band RMS
+// per sensor) and offers it to an ExceptionReporter, which passes it on only
+// when
+//   - the detection state changed (alarm, burst type, noise or dismiss
+//     flags),
+//   - a feature moved further than its tolerance from the last summary sent,
+//   - or nothing was sent for heartbeatMs, so the backend can tell a quiet
+//     device from a silent one. While an alarm is up the heartbeat is
+//     alarmHeartbeatMs, which also paces location and confidence updates.
+// The backend reads the time between two reports as unchanged.
+
+namespace leakdsp {
+
+// Defaults in ADC counts
+const int reportMeanTolerance = 6;
+const int reportExtremeTolerance = 40;
+const int reportRmsTolerance = 8;
+const int reportBandTolerance = 6;
+const uint32_t reportHeartbeatMs = 60000;  // must match HEARTBEAT_MS in backend/server.js
+const uint32_t reportAlarmHeartbeatMs = 1000;
+
+struct ReportTolerance {
+  ReportTolerance()
+      : mean(reportMeanTolerance), extreme(reportExtremeTolerance), rms(reportRmsTolerance),
+        band(reportBandTolerance), heartbeatMs(reportHeartbeatMs), alarmHeartbeatMs(reportAlarmHeartbeatMs) {}
+
+  int mean;     // window mean
+  int extreme;  // window min and max
+  int rms;
+  int band;     // burst band RMS
+  uint32_t heartbeatMs;
+  uint32_t alarmHeartbeatMs;
+};
+
+// Summary of one sensor's window. Window is a RollingWindow or a WindowBank
+// channel; the minimum and maximum take one pass over the filled slots.
+template <typename Window>
+SensorSummary summarizeWindow(const Window& window, int bandRms) {
+  SensorSummary summary;
+  int count = window.count();
+  int mean = window.mean();
+  summary.min = summary.max = count > 0 ? window[0] : 0;
+  for (int i = 1; i < count; i++) {
+    int value = window[i];
+    if (value < summary.min) summary.min = value;
+    if (value > summary.max) summary.max = value;
+  }
+  int64_t deviation = count > 0 ? window.squaredDeviation(mean) : 0;
+  summary.rms = count > 0 ? (int)isqrt64((uint64_t)(deviation > 0 ? deviation : 0) / count) : 0;
+  summary.bandRms = bandRms;
+  return summary;
+}
+
+enum ReportReason {
+  ReportSuppressed,
+  ReportHeartbeat,
+  ReportFeature,
+  ReportTransition
+};
+
+class ExceptionReporter {
+public:
+  explicit ExceptionReporter(const ReportTolerance& tolerance = ReportTolerance())
+      : tolerance_(tolerance), haveSent_(false), offered_(0), sent_(0) {
+    memset(&last_, 0, sizeof(last_));
+  }
+
+  void setTolerance(const ReportTolerance& tolerance) { tolerance_ = tolerance; }
+  const ReportTolerance& tolerance() const { return tolerance_; }
+
+  // Decides whether record goes out. Records sent only for the heartbeat
+  // get TelemetryHeartbeat.
+  ReportReason offer(TelemetryRecord& record) {
+    offered_++;
+    ReportReason reason = classify(record);
+    if (reason == ReportSuppressed) return reason;
+    if (reason == ReportHeartbeat) record.flags |= TelemetryHeartbeat;
+    last_ = record;
+    haveSent_ = true;
+    sent_++;
+    return reason;
+  }
+
+  uint32_t offered() const { return offered_; }
+  uint32_t sent() const { return sent_; }
+
+private:
+  ReportReason classify(const TelemetryRecord& record) const {
+    if (!haveSent_ || stateDiffers(record, last_)) return ReportTransition;
+    for (int s = 0; s < numSensors; s++) {
+      if (beyond(record.values[s], last_.values[s], tolerance_.mean)) return ReportFeature;
+      if (!(record.flags & TelemetrySummary)) continue;
+      const SensorSummary& now = record.summary[s];
+      const SensorSummary& then = last_.summary[s];
+      if (beyond(now.min, then.min, tolerance_.extreme) || beyond(now.max, then.max, tolerance_.extreme) ||
+          beyond(now.rms, then.rms, tolerance_.rms) || beyond(now.bandRms, then.bandRms, tolerance_.band)) {
+        return ReportFeature;
+      }
+    }
+    uint32_t heartbeatMs = (record.flags & telemetryAlarmFlags) ? tolerance_.alarmHeartbeatMs : tolerance_.heartbeatMs;
+    return record.timeMs - last_.timeMs >= heartbeatMs ? ReportHeartbeat : ReportSuppressed;
+  }
+
+  static bool beyond(int value, int reference, int tolerance) { return iabs(value - reference) > tolerance; }
+
+  ReportTolerance tolerance_;
+  TelemetryRecord last_;  // last record sent
+  bool haveSent_;
+  uint32_t offered_;
+  uint32_t sent_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_REPORT_BY_EXCEPTION_H
@@ -0,0 +1,331 @@
+#ifndef LEAKDSP_ROLLING_STATS_H
+#define LEAKDSP_ROLLING_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "sample_traits.h"
+
+// Constant-time rolling statistics over fixed-size sample windows.
+//
+// Sums are kept exactly in integers, so statistics about an integer mean
+// match a full rescan of the window bit for bit before the final division.
+
+namespace leakdsp {
+
+// Ring buffer of the last N samples with running sum and sum of squares.
+// T is the slot type; int16_t halves the storage for 12-bit ADC samples.
+template <int N, typename T = int>
+class RollingWindow {
+public:
+  static const int length = N;
+
+  RollingWindow() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < N; i++) values_[i] = 0;
+    index_ = 0;
+    count_ = 0;
+    sum_ = 0;
+    sumSquares_ = 0;
+  }
+
+  // Sets every slot to value and marks the window full.
+  void fill(int value) {
+    for (int i = 0; i < N; i++) values_[i] = (T)value;
+    index_ = 0;
+    count_ = N;
+    sum_ = (int32_t)value * N;
+    sumSquares_ = (int64_t)value * value * N;
+  }
+
+  // Adds a sample and returns the one it replaced (0 while filling).
+  int push(int value) {
+    int evicted = values_[index_];
+    values_[index_] = (T)value;
+    sum_ += value - evicted;
+    sumSquares_ += (int64_t)value * value - (int64_t)evicted * evicted;
+    index_ = (index_ + 1) % N;
+    if (count_ < N) count_++;
+    return evicted;
+  }
+
+  // Sample written `age` pushes ago; recent(0) is the newest.
+  int recent(int age) const { return values_[(index_ - 1 - age + 2 * N) % N]; }
+
+  // Raw slot access in storage order.
+  int operator[](int i) const { return values_[i]; }
+  const T* data() const { return values_; }
+
+  int count() const { return count_; }
+  int writeIndex() const { return index_; }
+  bool full() const { return count_ == N; }
+  static int capacity() { return N; }
+
+  int32_t sum() const { return sum_; }
+  int64_t sumSquares() const { return sumSquares_; }
+
+  // Integer mean, truncated like total / count.
+  int mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+
+  // Sum of (x - m)^2 over the filled slots.
+  int64_t squaredDeviation(int m) const {
+    return sumSquares_ - 2 * (int64_t)m * sum_ + (int64_t)count_ * m * m;
+  }
+
+  // Population variance about m; 0 for fewer than two samples.
+  float varianceAbout(int m) const {
+    if (count_ < 2) return 0;
+    return (float)squaredDeviation(m) / count_;
+  }
+
+  // Mean and population variance about the exact mean, both x16 and rounded,
+  // as a compact summary of the window.
+  int32_t meanQ4() const { return count_ > 0 ? (int32_t)(((int64_t)sum_ * 32 / count_ + 1) >> 1) : 0; }
+
+  uint32_t varianceQ4() const {
+    if (count_ < 2) return 0;
+    int64_t n = count_;
+    int64_t scaled = (n * sumSquares_ - (int64_t)sum_ * sum_) * 16;  // n^2 * variance * 16
+    return (uint32_t)((scaled + n * n / 2) / (n * n));
+  }
+
+  // Refills the window with N synthetic samples summarised by meanQ4() and
+  // varianceQ4(): pairs placed symmetrically about the mean, each pair's
+  // offset picked from the two integers around the standard deviation so the
+  // squared offsets average out to the variance.
+  void seed(int32_t meanQ4, uint32_t varianceQ4) {
+    const int pairs = N / 2;
+    int64_t total = ((int64_t)meanQ4 * N + 8) >> 4;
+    int base = (int)(total >= 0 ? total / N : (total - N + 1) / N);
+    int extra = (int)(total - (int64_t)base * N);  // slots one above base
+    int raisedPairs = extra / 2;  // whole pairs lifted by one keep their spread
+
+    // Squared offsets, x16 and summed over the pairs, that the raised pairs
+    // do not already contribute
+    uint64_t target = (uint64_t)varianceQ4 * pairs;
+    uint64_t lifted = (uint64_t)16 * raisedPairs * (pairs - raisedPairs) / (pairs > 0 ? pairs : 1);
+    target = target > lifted ? target - lifted : 0;
+    uint32_t low = isqrt64(target / (16 * (uint64_t)(pairs > 0 ? pairs : 1)));
+    uint64_t lowTotal = (uint64_t)low * low * 16 * pairs;
+    uint64_t step = 16 * (2 * (uint64_t)low + 1);  // (low + 1)^2 - low^2, x16
+    int highPairs = (int)((target - lowTotal + step / 2) / step);
+    if (highPairs > pairs) highPairs = pairs;
+
+    sum_ = 0;
+    sumSquares_ = 0;
+    for (int i = 0; i < N; i++) {
+      int pair = i / 2;
+      int value = base;
+      if (pair < pairs) {
+        int offset = (int)low + (pair < highPairs ? 1 : 0);
+        value += (i & 1) ? offset : -offset;
+        if (pair * raisedPairs / pairs != (pair + 1) * raisedPairs / pairs) value++;
+      }
+      if ((extra & 1) && i == N - 1) value++;
+      values_[i] = (T)value;
+      sum_ += value;
+      sumSquares_ += (int64_t)value * value;
+    }
+    index_ = 0;
+    count_ = N;
+  }
+
+private:
+  T values_[N];
+  int index_;
+  int count_;
+  int32_t sum_;
+  int64_t sumSquares_;
+};
+
+// Windows of the last N frames of S channels that advance together, stored
+// structure-of-arrays: one row of S samples per frame plus per-channel sums,
+// so a frame is pushed with contiguous loops over the channels.
+template <int S, int N, typename T = int>
+class WindowBank {
+public:
+  static const int channels = S;
+  static const int length = N;
+
+  // One channel with the RollingWindow read interface.
+  class Channel {
+  public:
+    static const int length = N;
+
+    Channel(const WindowBank& bank, int channel) : bank_(bank), channel_(channel) {}
+
+    int operator[](int i) const { return bank_.values_[i][channel_]; }
+    int recent(int age) const { return bank_.recent(channel_, age); }
+    int count() const { return bank_.count_; }
+    int writeIndex() const { return bank_.index_; }
+    bool full() const { return bank_.full(); }
+    int32_t sum() const { return bank_.sum_[channel_]; }
+    int mean() const { return bank_.mean(channel_); }
+    int64_t squaredDeviation(int m) const { return bank_.squaredDeviation(channel_, m); }
+    float varianceAbout(int m) const { return bank_.varianceAbout(channel_, m); }
+
+  private:
+    const WindowBank& bank_;
+    int channel_;
+  };
+
+  WindowBank() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < N; i++) {
+      for (int c = 0; c < S; c++) values_[i][c] = 0;
+    }
+    for (int c = 0; c < S; c++) {
+      sum_[c] = 0;
+      sumSquares_[c] = 0;
+    }
+    index_ = 0;
+    count_ = 0;
+  }
+
+  // Adds one frame and writes the frame it replaced (zeros while filling).
+  void push(const int* frame, int* evicted) {
+    T* row = values_[index_];
+    for (int c = 0; c < S; c++) {
+      int in = frame[c];
+      int out = row[c];
+      evicted[c] = out;
+      row[c] = (T)in;
+      sum_[c] += in - out;
+      sumSquares_[c] += (int64_t)in * in - (int64_t)out * out;
+    }
+    index_ = (index_ + 1) % N;
+    if (count_ < N) count_++;
+  }
+
+  Channel channel(int c) const { return Channel(*this, c); }
+
+  int recent(int c, int age) const { return values_[(index_ - 1 - age + 2 * N) % N][c]; }
+  int count() const { return count_; }
+  bool full() const { return count_ == N; }
+  int32_t sum(int c) const { return sum_[c]; }
+  int mean(int c) const { return count_ > 0 ? sum_[c] / count_ : 0; }
+
+  int64_t squaredDeviation(int c, int m) const {
+    return sumSquares_[c] - 2 * (int64_t)m * sum_[c] + (int64_t)count_ * m * m;
+  }
+
+  float varianceAbout(int c, int m) const {
+    if (count_ < 2) return 0;
+    return (float)squaredDeviation(c, m) / count_;
+  }
+
+private:
+  T values_[N][S];
+  int32_t sum_[S];
+  int64_t sumSquares_[S];
+  int index_;
+  int count_;
+};
+
+// Running cross products between C channels whose windows advance together.
+// Pair (i, j) with i < j is stored at pairIndex(i, j), row by row, so the
+// pairs of channel i with every later channel are contiguous.
+template <int C>
+class RollingCoMoments {
+public:
+  static const int pairs = C * (C - 1) / 2;
+
+  RollingCoMoments() { clear(); }
+
+  void clear() {
+    for (int p = 0; p < pairs; p++) cross_[p] = 0;
+  }
+
+  static int pairIndex(int i, int j) { return i * (2 * C - i - 1) / 2 + (j - i - 1); }
+
+  // Applies one frame: incoming samples enter, outgoing (evicted) samples leave.
+  void update(const int* incoming, const int* outgoing) {
+    int64_t* row = cross_;
+    for (int i = 0; i < C - 1; i++) {
+      int64_t in = incoming[i];
+      int64_t out = outgoing[i];
+      for (int j = i + 1; j < C; j++) row[j - i - 1] += in * incoming[j] - out * outgoing[j];
+      row += C - i - 1;
+    }
+  }
+
+  int64_t crossSum(int i, int j) const { return cross_[pairIndex(i, j)]; }
+
+  // Pearson correlation of every pair of a full bank about integer means,
+  // sum((x - mx)(y - my)) / sqrt(sum((x - mx)^2) * sum((y - my)^2)), into
+  // out[pairIndex(i, j)]. One square root per channel; the pair loops only
+  // multiply.
+  template <int N, typename T>
+  void correlationMatrix(const WindowBank<C, N, T>& bank, float* out) const {
+    int means[C];
+    int32_t sums[C];
+    float inverseSpread[C];
+    for (int c = 0; c < C; c++) {
+      means[c] = bank.mean(c);
+      sums[c] = bank.sum(c);
+      int64_t deviation = bank.squaredDeviation(c, means[c]);
+      inverseSpread[c] = deviation > 0 ? 1.0f / sqrtf((float)deviation) : 0;
+    }
+    int64_t centered[pairs > 0 ? pairs : 1];
+    centeredCross(N, means, sums, centered);
+    const int64_t* row = centered;
+    for (int i = 0; i < C - 1; i++) {
+      float scale = inverseSpread[i];
+      for (int j = i + 1; j < C; j++) out[j - i - 1] = (float)row[j - i - 1] * scale * inverseSpread[j];
+      row += C - i - 1;
+      out += C - i - 1;
+    }
+  }
+
+  // The same matrix in Q14. Each channel gets one integer square root and one
+  // reciprocal 2^31 / spread; since |cross| <= spread_i * spread_j, scaling
+  // by one reciprocal and then the other stays inside 62 bits, so the pair
+  // loops only multiply and shift.
+  template <int N, typename T>
+  void correlationMatrixQ14(const WindowBank<C, N, T>& bank, int32_t* out) const {
+    int means[C];
+    int32_t sums[C];
+    int64_t inverseSpread[C];  // 2^31 / sqrt(sum((x - m)^2)), 0 for a flat channel
+    for (int c = 0; c < C; c++) {
+      means[c] = bank.mean(c);
+      sums[c] = bank.sum(c);
+      uint32_t spreadQ8 = isqrt64((uint64_t)bank.squaredDeviation(c, means[c]) << 16);
+      inverseSpread[c] = spreadQ8 > 0 ? (int64_t)(((uint64_t)1 << 39) / spreadQ8) : 0;
+    }
+    int64_t centered[pairs > 0 ? pairs : 1];
+    centeredCross(N, means, sums, centered);
+    const int64_t* row = centered;
+    for (int i = 0; i < C - 1; i++) {
+      int64_t scale = inverseSpread[i];
+      for (int j = i + 1; j < C; j++) {
+        int64_t partial = (row[j - i - 1] * scale) >> 1;  // cross / spread_i, Q30
+        out[j - i - 1] = (int32_t)((partial * inverseSpread[j]) >> (61 - correlationShift));
+      }
+      row += C - i - 1;
+      out += C - i - 1;
+    }
+  }
+
+private:
+  // sum((x - mx)(y - my)) for every pair from the raw cross sums.
+  void centeredCross(int n, const int* means, const int32_t* sums, int64_t* out) const {
+    const int64_t* row = cross_;
+    for (int i = 0; i < C - 1; i++) {
+      int64_t mx = means[i];
+      int64_t sx = sums[i];
+      for (int j = i + 1; j < C; j++) {
+        out[j - i - 1] = row[j - i - 1] - means[j] * sx - mx * sums[j] + n * mx * means[j];
+      }
+      row += C - i - 1;
+      out += C - i - 1;
+    }
+  }
+
+  int64_t cross_[pairs > 0 ? pairs : 1];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_ROLLING_STATS_H
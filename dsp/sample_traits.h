@@ -0,0 +1,59 @@
+#ifndef LEAKDSP_SAMPLE_TRAITS_H
+#define LEAKDSP_SAMPLE_TRAITS_H
+
+#include <stdint.h>
+
+// Sample and statistics types the detector is instantiated with.
+//
+// FloatTraits keeps the original int windows and float statistics and serves
+// as the reference. FixedTraits stores 12-bit ADC samples as int16_t and does
+// every per-frame statistic in integers: variances stay as exact scaled sums,
+// ratios compare by cross-multiplication against Q16 constants, and square
+// roots are integer. DetectorMath in leak_detector.h holds the two variants.
+
+namespace leakdsp {
+
+// A dimensionless threshold in both representations, built at compile time.
+struct Ratio {
+  float value;
+  int32_t q16;
+};
+
+constexpr Ratio ratio(double value) { return Ratio{(float)value, (int32_t)(value * 65536.0 + 0.5)}; }
+
+const int correlationShift = 14;  // fixed-point correlation coefficients are Q14
+
+struct FloatTraits {
+  typedef int Sample;     // window slot
+  typedef float Level;    // amplitude history entry
+  typedef float Stat;     // variances
+  typedef float Score;    // correlation coefficient
+  static const bool fixedPoint = false;
+};
+
+struct FixedTraits {
+  typedef int16_t Sample;
+  typedef int16_t Level;
+  typedef int64_t Stat;   // count * variance, kept exact
+  typedef int32_t Score;  // Q14
+  static const bool fixedPoint = true;
+};
+
+// floor(sqrt(value)), bit by bit from the highest even bit at or below value.
+inline uint32_t isqrt64(uint64_t value) {
+  if (value == 0) return 0;
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << ((63 - __builtin_clzll(value)) & ~1);
+  while (bit != 0) {
+    uint64_t trial = root + bit;
+    uint64_t take = value >= trial ? ~(uint64_t)0 : 0;  // branch-free, data-dependent bits mispredict
+    value -= trial & take;
+    root = (root >> 1) + (bit & take);
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_SAMPLE_TRAITS_H
@@ -0,0 +1,58 @@
+#ifndef LEAKDSP_SPSC_RING_H
+#define LEAKDSP_SPSC_RING_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Single-producer/single-consumer lock-free ring buffer.
+//
+// One task or thread may call push(), one other may call pop(). Head and tail
+// are free-running counters; N must be a power of two. Each side only writes
+// its own index, with release ordering so the slot contents are visible
+// before the index moves.
+
+namespace leakdsp {
+
+template <typename T, uint32_t N>
+class SpscRing {
+public:
+  SpscRing() : head_(0), tail_(0) {}
+
+  // Producer side. Returns false when the ring is full; the item is dropped.
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= N) return false;
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool pop(T& item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate when called concurrently with the other side.
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static uint32_t capacity() { return N; }
+
+private:
+  static_assert((N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+  // Producer and consumer indices on separate cache lines
+  alignas(64) std::atomic<uint32_t> head_;
+  alignas(64) std::atomic<uint32_t> tail_;
+  T items_[N];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_SPSC_RING_H
@@ -0,0 +1,133 @@
+#ifndef LEAKDSP_TDOA_H
+#define LEAKDSP_TDOA_H
+
+#include <math.h>
+
+#include "fft.h"
+#include "rolling_stats.h"
+
+// Time difference of arrival between two sensor windows.
+//
+// Cross-correlation is computed through the frequency domain: both windows
+// are packed into one complex FFT (a in the real part, b in the imaginary
+// part), the cross spectrum A*conj(B) is formed from the symmetric bins and a
+// single inverse FFT yields every lag at once. Zero padding to 2N keeps the
+// correlation linear rather than circular.
+
+namespace leakdsp {
+
+constexpr int nextPowerOfTwo(int n, int p = 1) { return p >= n ? p : nextPowerOfTwo(n, p * 2); }
+
+struct DelayEstimate {
+  float lagSamples;   // > 0: the first window arrives later than the second
+  float coefficient;  // normalized cross-correlation at the peak (-1..1)
+  bool valid;
+};
+
+template <int N>
+class CrossCorrelator {
+public:
+  static const int fftSize = nextPowerOfTwo(2 * N);
+
+  // Searches lags in [-maxLag, maxLag] for the strongest correlation and
+  // refines it with a parabolic fit.
+  // Windows of N samples: RollingWindow<N> or WindowBank channels.
+  template <typename Window>
+  DelayEstimate estimate(const Window& a, const Window& b, int maxLag) {
+    DelayEstimate result;
+    result.lagSamples = 0;
+    result.coefficient = 0;
+    result.valid = false;
+    if (maxLag > N - 1) maxLag = N - 1;
+
+    correlate(a, b);
+    if (energyA_ <= 0 || energyB_ <= 0) return result;
+
+    int best = 0;
+    float bestValue = lagValue(0);
+    for (int lag = -maxLag; lag <= maxLag; lag++) {
+      float value = lagValue(lag);
+      if (fabsf(value) > fabsf(bestValue)) {
+        bestValue = value;
+        best = lag;
+      }
+    }
+
+    float offset = 0;
+    if (best > -maxLag && best < maxLag) {
+      float left = lagValue(best - 1);
+      float right = lagValue(best + 1);
+      float curvature = left - 2 * bestValue + right;
+      if (curvature != 0) offset = 0.5f * (left - right) / curvature;
+      if (offset > 0.5f || offset < -0.5f) offset = 0;
+    }
+
+    result.lagSamples = best + offset;
+    result.coefficient = bestValue / sqrtf(energyA_ * energyB_);
+    result.valid = true;
+    return result;
+  }
+
+  // Raw correlation sum at `lag` from the last estimate().
+  float lagValue(int lag) const { return correlation_[lag >= 0 ? lag : fftSize + lag]; }
+
+private:
+  template <typename Window>
+  void correlate(const Window& a, const Window& b) {
+    int meanA = a.mean();
+    int meanB = b.mean();
+    int startA = a.writeIndex();
+    int startB = b.writeIndex();
+    energyA_ = 0;
+    energyB_ = 0;
+    for (int n = 0; n < fftSize; n++) {
+      if (n < N) {
+        re_[n] = (float)(a[(startA + n) % N] - meanA);
+        im_[n] = (float)(b[(startB + n) % N] - meanB);
+        energyA_ += re_[n] * re_[n];
+        energyB_ += im_[n] * im_[n];
+      } else {
+        re_[n] = 0;
+        im_[n] = 0;
+      }
+    }
+
+    fft_.forward(re_, im_);
+
+    // Split Z = A + jB into A and B, then form A * conj(B).
+    for (int k = 0; k < fftSize; k++) {
+      int m = (fftSize - k) & (fftSize - 1);
+      float ar = 0.5f * (re_[k] + re_[m]);
+      float ai = 0.5f * (im_[k] - im_[m]);
+      float br = 0.5f * (im_[k] + im_[m]);
+      float bi = -0.5f * (re_[k] - re_[m]);
+      correlation_[k] = ar * br + ai * bi;
+      crossIm_[k] = ai * br - ar * bi;
+    }
+
+    fft_.inverse(correlation_, crossIm_);
+    const float scale = 1.0f / fftSize;
+    for (int k = 0; k < fftSize; k++) correlation_[k] *= scale;
+  }
+
+  Fft<fftSize> fft_;
+  float re_[fftSize];
+  float im_[fftSize];
+  float correlation_[fftSize];
+  float crossIm_[fftSize];
+  float energyA_;
+  float energyB_;
+};
+
+// Position of a leak between two sensors `spacingM` apart, measured from the
+// first sensor, given arrival delay first minus second. Clamped to the segment.
+inline float leakPositionM(float delaySeconds, float spacingM, float waveSpeedMps) {
+  float position = 0.5f * (spacingM + waveSpeedMps * delaySeconds);
+  if (position < 0) return 0;
+  if (position > spacingM) return spacingM;
+  return position;
+}
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_TDOA_H
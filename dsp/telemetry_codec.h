@@ -0,0 +1,214 @@
+#ifndef LEAKDSP_TELEMETRY_CODEC_H
+#define LEAKDSP_TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "detector_config.h"
+#include "leak_detector.h"
+
+// Binary batched telemetry frame, decoded by backend/telemetry.js.
+//
+// Frame (version 2, multi-byte integers little-endian):
+//   'L' 'T'  version  sensorCount  recordCount  baseTimeMs (uint32)
+// then recordCount records of:
+//   varint    ms since the previous record (0 for the first)
+//   byte      flags (TelemetryFlag bits)
+//   byte      burst type (BurstTypeCode)
+//   byte      location kind (LocationKind), then its arguments:
+//               Near: sensor   Between: sensor, sensor   Segment: sensor, varint decimetres
+//   varint    confidence x10
+//   varint    correlation score, stability score, active sensors
+//   varint    burst intensity x10
+//   zigzag    per sensor: value minus the previous record's value (absolute in the first)
+//   with TelemetrySummary in flags, per sensor:
+//     zigzag  value minus the window minimum, window maximum minus value
+//     varint  RMS about the window mean, burst band RMS
+//
+// Codes replace the free-text burst type and location, and sensor deltas are
+// usually one byte, so a record is ~13 bytes against ~300 of JSON, ~27 with
+// the summaries. Version 1 is the same without TelemetrySummary.
+
+namespace leakdsp {
+
+const uint8_t telemetryFormatVersion = 2;
+const int telemetryBatchRecords = 10;       // records per request at most
+const uint32_t telemetryBatchMaxAgeMs = 1000;  // oldest record held back before a partial batch goes
+
+enum TelemetryFlag {
+  TelemetryLeak = 1 << 0,
+  TelemetryBurst = 1 << 1,
+  TelemetryCatastrophic = 1 << 2,
+  TelemetryEnvironmentalNoise = 1 << 3,
+  TelemetryDismissed = 1 << 4,
+  TelemetryHeartbeat = 1 << 5,  // sent only because the heartbeat was due
+  TelemetrySummary = 1 << 6     // per-sensor window summary follows
+};
+const uint8_t telemetryAlarmFlags = TelemetryLeak | TelemetryBurst | TelemetryCatastrophic;
+const uint8_t telemetryStateFlags = telemetryAlarmFlags | TelemetryEnvironmentalNoise | TelemetryDismissed;
+
+enum BurstTypeCode {
+  BurstTypeNormal,
+  BurstTypeNormalFlow,
+  BurstTypePipelineLeak,
+  BurstTypePipelineBurst,
+  BurstTypeCatastrophicBurst,
+  BurstTypeCount
+};
+
+// Index = BurstTypeCode; must match burstTypes in backend/telemetry.js.
+const char* const burstTypeNames[BurstTypeCount] = {
+  "NORMAL", "NORMAL FLOW", "PIPELINE LEAK", "PIPELINE BURST", "CATASTROPHIC BURST"
+};
+
+inline uint8_t burstTypeCode(const char* name) {
+  for (int i = 0; i < BurstTypeCount; i++) {
+    if (strcmp(name, burstTypeNames[i]) == 0) return (uint8_t)i;
+  }
+  return BurstTypeNormalFlow;
+}
+
+// Shape of one sensor's signal over a summary window, in ADC counts. The
+// window mean is the record's value.
+struct SensorSummary {
+  int min;
+  int max;
+  int rms;      // about the window mean
+  int bandRms;  // burst band only, 0 where the firmware has no spectrum
+};
+
+// One reading as sent; filled by the firmware from its detection state.
+struct TelemetryRecord {
+  uint32_t timeMs;
+  int values[numSensors];
+  SensorSummary summary[numSensors];  // with TelemetrySummary
+  uint8_t flags;
+  uint8_t burstType;
+  uint8_t locationKind;
+  uint8_t locationA, locationB;  // sensors, 0-based
+  uint32_t positionDm;           // LocationSegment only
+  uint32_t confidence10;
+  uint32_t correlationScore;
+  uint32_t stabilityScore;
+  uint32_t activeSensors;
+  uint32_t burstIntensity10;
+};
+
+// True when the two records describe different detection states: alarm,
+// burst type or noise/dismiss flags. Location is left out; it wanders between
+// sensor pairs from window to window while an event lasts.
+inline bool stateDiffers(const TelemetryRecord& a, const TelemetryRecord& b) {
+  return (a.flags & telemetryStateFlags) != (b.flags & telemetryStateFlags) || a.burstType != b.burstType;
+}
+
+// Worst-case encoded sizes (5-byte varints everywhere)
+const int telemetryHeaderBytes = 9;
+const int telemetryRecordMaxBytes = 5 + 1 + 1 + 7 + 5 * 5 + numSensors * 5 * 5;
+const int telemetryFrameMaxBytes = telemetryHeaderBytes + telemetryBatchRecords * telemetryRecordMaxBytes;
+
+// Accumulates records into one frame in a fixed buffer. No heap use.
+class TelemetryBatch {
+public:
+  TelemetryBatch() {
+    memset(&last_, 0, sizeof(last_));
+    clear();
+  }
+
+  void clear() {
+    size_ = telemetryHeaderBytes;
+    count_ = 0;
+    stateChanged_ = false;
+    buffer_[0] = 'L';
+    buffer_[1] = 'T';
+    buffer_[2] = telemetryFormatVersion;
+    buffer_[3] = (uint8_t)numSensors;
+    buffer_[4] = 0;
+  }
+
+  // Appends a record. Returns false when the batch is already full.
+  bool add(const TelemetryRecord& record) {
+    if (count_ >= telemetryBatchRecords) return false;
+    if (count_ == 0) {
+      writeLe32(buffer_ + 5, record.timeMs);
+      firstTimeMs_ = record.timeMs;
+      last_.timeMs = record.timeMs;
+      for (int s = 0; s < numSensors; s++) last_.values[s] = 0;
+    }
+    if (stateDiffers(record, last_)) stateChanged_ = true;
+
+    putVarint(record.timeMs - last_.timeMs);
+    buffer_[size_++] = record.flags;
+    buffer_[size_++] = record.burstType;
+    buffer_[size_++] = record.locationKind;
+    if (record.locationKind == LocationNear) {
+      buffer_[size_++] = record.locationA;
+    } else if (record.locationKind == LocationBetween) {
+      buffer_[size_++] = record.locationA;
+      buffer_[size_++] = record.locationB;
+    } else if (record.locationKind == LocationSegment) {
+      buffer_[size_++] = record.locationA;
+      putVarint(record.positionDm);
+    }
+    putVarint(record.confidence10);
+    putVarint(record.correlationScore);
+    putVarint(record.stabilityScore);
+    putVarint(record.activeSensors);
+    putVarint(record.burstIntensity10);
+    for (int s = 0; s < numSensors; s++) putVarint(zigzag(record.values[s] - last_.values[s]));
+    if (record.flags & TelemetrySummary) {
+      for (int s = 0; s < numSensors; s++) {
+        const SensorSummary& summary = record.summary[s];
+        putVarint(zigzag(record.values[s] - summary.min));
+        putVarint(zigzag(summary.max - record.values[s]));
+        putVarint((uint32_t)imax(0, summary.rms));
+        putVarint((uint32_t)imax(0, summary.bandRms));
+      }
+    }
+
+    last_ = record;
+    buffer_[4] = (uint8_t)++count_;
+    return true;
+  }
+
+  // Send when full, once the oldest record has waited telemetryBatchMaxAgeMs,
+  // or right away when the detection state changed so alerts are not held
+  // back by batching.
+  bool ready(uint32_t nowMs) const {
+    if (count_ == 0) return false;
+    return count_ >= telemetryBatchRecords || stateChanged_ || nowMs - firstTimeMs_ >= telemetryBatchMaxAgeMs;
+  }
+
+  int count() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  const uint8_t* data() const { return buffer_; }
+  size_t size() const { return size_; }
+
+private:
+  static uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+
+  static void writeLe32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+  }
+
+  void putVarint(uint32_t value) {
+    while (value >= 0x80) {
+      buffer_[size_++] = (uint8_t)(value | 0x80);
+      value >>= 7;
+    }
+    buffer_[size_++] = (uint8_t)value;
+  }
+
+  uint8_t buffer_[telemetryFrameMaxBytes];
+  size_t size_;
+  int count_;
+  uint32_t firstTimeMs_;
+  TelemetryRecord last_;  // previous record, across batches
+  bool stateChanged_;
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_TELEMETRY_CODEC_H
@@ -0,0 +1,214 @@
+#ifndef LEAKDSP_TRANSMIT_H
+#define LEAKDSP_TRANSMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "platform.h"
+#include "spsc_ring.h"
+#include "telemetry_codec.h"
+
+// Asynchronous telemetry uplink.
+//
+// The network task enqueues encoded batches into a bounded SPSC queue; a
+// transmit task drains it with Transmitter::poll() over one persistent
+// connection. Failed sends back off exponentially. While the link is down,
+// after a failure, or while older data is still spooled, queued batches are
+// spilled to a Spool (flash on the board) and replayed oldest first, so the
+// backend sees batches in order.
+
+namespace leakdsp {
+
+const uint32_t transmitQueueSize = 8;        // batches, ~8 s of telemetry
+const uint32_t transmitBackoffInitialMs = 250;
+const uint32_t transmitBackoffMaxMs = 30000;
+
+// HTTP-like uplink. post() returns the status code, or a negative value when
+// no response arrived (connection refused, timeout).
+class Transport {
+public:
+  virtual ~Transport() {}
+  virtual bool connected() = 0;  // link layer up (WiFi associated)
+  virtual int post(const uint8_t* data, size_t size) = 0;
+};
+
+// Persistent FIFO of encoded batches.
+class Spool {
+public:
+  virtual ~Spool() {}
+  virtual bool append(const uint8_t* data, size_t size) = 0;
+  // Copies the oldest record into data; false when empty or it does not fit.
+  virtual bool front(uint8_t* data, size_t capacity, size_t* size) = 0;
+  virtual void popFront() = 0;
+  virtual uint32_t count() const = 0;
+  virtual bool canAppend(size_t size) const = 0;
+};
+
+struct EncodedBatch {
+  uint32_t enqueuedMs;
+  uint16_t size;
+  uint8_t bytes[telemetryFrameMaxBytes];
+};
+
+typedef SpscRing<EncodedBatch, transmitQueueSize> TransmitQueue;
+
+// Counter snapshot; safe to take from any task.
+struct TransmitStats {
+  uint32_t queueDepth;
+  uint32_t spoolDepth;
+  uint32_t enqueued;
+  uint32_t dropped;       // queue full and spool unable to take more
+  uint32_t sent;          // acknowledged with 2xx, including replays
+  uint32_t replayed;      // of which came from the spool
+  uint32_t spooled;
+  uint32_t failures;      // attempts without a 2xx/4xx answer
+  uint32_t rejected;      // 4xx answers; the batch is discarded
+  uint32_t lastLatencyMs; // enqueue to acknowledgement, queue path only
+  uint32_t maxLatencyMs;
+};
+
+class Transmitter {
+public:
+  Transmitter(Transport& transport, Spool& spool, Clock& clock)
+      : transport_(transport), spool_(spool), clock_(clock),
+        backoffMs_(0), retryAtMs_(0), spoolDepth_(0) {
+    for (int i = 0; i < CounterCount; i++) counters_[i].store(0, std::memory_order_relaxed);
+  }
+
+  // Producer side (network task). Returns false when the batch was dropped.
+  bool enqueue(const TelemetryBatch& batch) {
+    slot_.enqueuedMs = clock_.nowMs();
+    slot_.size = (uint16_t)batch.size();
+    memcpy(slot_.bytes, batch.data(), batch.size());
+    if (!queue_.push(slot_)) {
+      bump(Dropped);
+      return false;
+    }
+    bump(Enqueued);
+    return true;
+  }
+
+  // Consumer side (transmit task). Sends or spills at most one batch.
+  void poll() {
+    uint32_t nowMs = clock_.nowMs();
+    spoolDepth_.store(spool_.count(), std::memory_order_relaxed);
+    bool linkUp = transport_.connected();
+    bool waiting = backoffMs_ != 0 && (int32_t)(nowMs - retryAtMs_) < 0;
+
+    // The spool always holds older data than the queue
+    if (!linkUp || waiting || spool_.count() > 0) spillQueue();
+    if (!linkUp || waiting) return;
+
+    if (spool_.count() > 0) {
+      size_t size;
+      if (!spool_.front(buffer_.bytes, sizeof(buffer_.bytes), &size)) {
+        spool_.popFront();  // unreadable record
+        spoolDepth_.store(spool_.count(), std::memory_order_relaxed);
+        return;
+      }
+      int status = transport_.post(buffer_.bytes, size);
+      if (delivered(status, nowMs)) {
+        spool_.popFront();
+        spoolDepth_.store(spool_.count(), std::memory_order_relaxed);
+        if (status < 400) bump(Replayed);
+      }
+      return;
+    }
+
+    if (!queue_.pop(buffer_)) return;
+    int status = transport_.post(buffer_.bytes, buffer_.size);
+    if (delivered(status, nowMs)) {
+      if (status < 400) {
+        uint32_t latency = clock_.nowMs() - buffer_.enqueuedMs;
+        counters_[LastLatency].store(latency, std::memory_order_relaxed);
+        if (latency > counters_[MaxLatency].load(std::memory_order_relaxed)) {
+          counters_[MaxLatency].store(latency, std::memory_order_relaxed);
+        }
+      }
+    } else {
+      spill(buffer_);
+    }
+  }
+
+  TransmitStats stats() const {
+    TransmitStats s;
+    s.queueDepth = queue_.size();
+    s.spoolDepth = spoolDepth_.load(std::memory_order_relaxed);
+    s.enqueued = counter(Enqueued);
+    s.dropped = counter(Dropped);
+    s.sent = counter(Sent);
+    s.replayed = counter(Replayed);
+    s.spooled = counter(Spooled);
+    s.failures = counter(Failures);
+    s.rejected = counter(Rejected);
+    s.lastLatencyMs = counter(LastLatency);
+    s.maxLatencyMs = counter(MaxLatency);
+    return s;
+  }
+
+  uint32_t backoffMs() const { return backoffMs_; }
+
+private:
+  enum Counter {
+    Enqueued, Dropped, Sent, Replayed, Spooled, Failures, Rejected, LastLatency, MaxLatency,
+    CounterCount
+  };
+
+  // True when the batch is done with: acknowledged, or rejected for good.
+  bool delivered(int status, uint32_t nowMs) {
+    if (status >= 200 && status < 300) {
+      bump(Sent);
+      backoffMs_ = 0;
+      return true;
+    }
+    if (status >= 400 && status < 500) {
+      bump(Rejected);
+      backoffMs_ = 0;
+      return true;
+    }
+    bump(Failures);
+    backoffMs_ = backoffMs_ == 0 ? transmitBackoffInitialMs : backoffMs_ * 2;
+    if (backoffMs_ > transmitBackoffMaxMs) backoffMs_ = transmitBackoffMaxMs;
+    retryAtMs_ = nowMs + backoffMs_;
+    return false;
+  }
+
+  // Moves queued batches behind the spooled ones while the spool has room.
+  // When it is full they stay queued and the producer sees the backpressure.
+  void spillQueue() {
+    while (!queue_.empty() && spool_.canAppend(telemetryFrameMaxBytes)) {
+      if (!queue_.pop(buffer_)) break;
+      spill(buffer_);
+    }
+  }
+
+  void spill(const EncodedBatch& batch) {
+    if (spool_.append(batch.bytes, batch.size)) {
+      bump(Spooled);
+    } else {
+      bump(Dropped);
+    }
+    spoolDepth_.store(spool_.count(), std::memory_order_relaxed);
+  }
+
+  void bump(Counter c) { counters_[c].fetch_add(1, std::memory_order_relaxed); }
+  uint32_t counter(Counter c) const { return counters_[c].load(std::memory_order_relaxed); }
+
+  Transport& transport_;
+  Spool& spool_;
+  Clock& clock_;
+  TransmitQueue queue_;
+  EncodedBatch slot_;    // producer scratch
+  EncodedBatch buffer_;  // consumer scratch
+  uint32_t backoffMs_;
+  uint32_t retryAtMs_;
+  std::atomic<uint32_t> spoolDepth_;
+  std::atomic<uint32_t> counters_[CounterCount];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_TRANSMIT_H
@@ -0,0 +1,218 @@
+#ifndef LEAKDSP_WAVEFORM_CAPTURE_H
+#define LEAKDSP_WAVEFORM_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "detector_config.h"
+#include "telemetry_codec.h"
+
+// Pre/post-trigger capture of the raw samples around a detection event,
+// decoded by backend/waveform.js.
+//
+// Every raw frame goes into a ring of capturePreMs + capturePostMs at
+// sampleRateHz. When the detector confirms an event the ring keeps running
+// for capturePostMs and then freezes, holding capturePreMs before the
+// trigger frame and capturePostMs from it. The frozen capture is encoded
+// once and uploaded; the ring re-arms when the upload slot is free again.
+//
+// Frame (version 1, multi-byte integers little-endian):
+//   'L' 'W'  version  sensorCount  sampleRateHz (uint16)  frameCount (uint16)
+//   triggerFrame (uint16)  triggerTimeMs (uint32)  burstType (BurstTypeCode)
+// then a bit stream, most significant bit first, per sensor in turn:
+//   16 bits   first sample (two's complement)
+//   per block of waveformBlock sample-to-sample differences:
+//     4 bits  Rice parameter k
+//     per difference, zigzag-mapped to v: v >> k in unary (ones, then a
+//     zero) and the low k bits; when v >> k reaches waveformEscape, that many
+//     ones and then v in waveformEscapeBits bits instead
+// padded with zero bits to a whole byte.
+//
+// Piezo noise differences are a few counts, so a sample costs 3-5 bits
+// against 16 raw.
+
+namespace leakdsp {
+
+const uint8_t waveformFormatVersion = 1;
+const int capturePreMs = 2000;
+const int capturePostMs = 1000;
+const int waveformHeaderBytes = 15;
+const int waveformBlock = 32;
+const int waveformEscape = 16;
+const int waveformEscapeBits = 17;  // any difference of two int16 samples, zigzagged
+
+// MSB-first bit packer over a fixed buffer. Writes past the end are counted
+// but dropped, so overflow() can be checked once at the end.
+class BitWriter {
+public:
+  BitWriter(uint8_t* out, size_t capacity) : out_(out), capacity_(capacity), size_(0), bits_(0), pending_(0) {}
+
+  void put(uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) putBit((value >> i) & 1);
+  }
+
+  void putOnes(int count) {
+    for (int i = 0; i < count; i++) putBit(1);
+  }
+
+  // Pads to a whole byte and returns the bytes written.
+  size_t finish() {
+    while (bits_ != 0) putBit(0);
+    return size_;
+  }
+
+  bool overflow() const { return size_ > capacity_; }
+
+private:
+  void putBit(uint32_t bit) {
+    pending_ = (uint8_t)((pending_ << 1) | bit);
+    if (++bits_ < 8) return;
+    if (size_ < capacity_) out_[size_] = pending_;
+    size_++;
+    bits_ = 0;
+    pending_ = 0;
+  }
+
+  uint8_t* out_;
+  size_t capacity_;
+  size_t size_;
+  int bits_;
+  uint8_t pending_;
+};
+
+template <int S>
+class BasicWaveformCapture {
+public:
+  static const int preFrames = capturePreMs * sampleRateHz / 1000;
+  static const int postFrames = capturePostMs * sampleRateHz / 1000;
+  static const int capacity = preFrames + postFrames;
+  // Escape-coded differences everywhere plus one k per block
+  static const int maxBytes =
+      waveformHeaderBytes + (S * (16 + ((capacity + waveformBlock - 1) / waveformBlock) * 4 +
+                                  (capacity - 1) * (waveformEscape + waveformEscapeBits)) + 7) / 8;
+
+  BasicWaveformCapture() : triggerCount_(0), lastTimeMs_(0), triggerTimeMs_(0), burstType_(0) { rearm(); }
+
+  // Drops the frozen capture and starts filling the pre-trigger ring again.
+  void rearm() {
+    index_ = 0;
+    count_ = 0;
+    postRemaining_ = -1;
+  }
+
+  // Records one raw frame; ignored once the capture is complete.
+  void push(const int* values, uint32_t timeMs) {
+    if (complete()) return;
+    int16_t* row = frames_[index_];
+    for (int s = 0; s < S; s++) row[s] = (int16_t)values[s];
+    index_ = (index_ + 1) % capacity;
+    if (count_ < capacity) count_++;
+    lastTimeMs_ = timeMs;
+    if (postRemaining_ > 0) postRemaining_--;
+  }
+
+  // Marks the frame just pushed as the trigger. Ignored while a capture is
+  // already running or waiting to be sent.
+  void trigger(uint8_t burstType) {
+    if (postRemaining_ >= 0 || count_ == 0) return;
+    triggerTimeMs_ = lastTimeMs_;
+    burstType_ = burstType;
+    postRemaining_ = postFrames - 1;
+    triggerCount_ = count_;
+  }
+
+  bool triggered() const { return postRemaining_ >= 0; }
+  bool complete() const { return postRemaining_ == 0; }
+  int frames() const { return count_; }
+
+  // Encodes a complete capture into out. Returns the size, or 0 when it is
+  // not complete or out is too small.
+  size_t encode(uint8_t* out, size_t size) const {
+    if (!complete() || size < (size_t)waveformHeaderBytes) return 0;
+    // Frames before the trigger still in the ring, oldest first
+    int before = triggerCount_ - 1 < preFrames ? triggerCount_ - 1 : preFrames;
+    int frameCount = before + postFrames;
+    int oldest = (index_ - frameCount + 2 * capacity) % capacity;
+
+    out[0] = 'L';
+    out[1] = 'W';
+    out[2] = waveformFormatVersion;
+    out[3] = (uint8_t)S;
+    putLe16(out + 4, (uint16_t)sampleRateHz);
+    putLe16(out + 6, (uint16_t)frameCount);
+    putLe16(out + 8, (uint16_t)before);
+    out[10] = (uint8_t)triggerTimeMs_;
+    out[11] = (uint8_t)(triggerTimeMs_ >> 8);
+    out[12] = (uint8_t)(triggerTimeMs_ >> 16);
+    out[13] = (uint8_t)(triggerTimeMs_ >> 24);
+    out[14] = burstType_;
+
+    BitWriter bits(out + waveformHeaderBytes, size - waveformHeaderBytes);
+    uint32_t block[waveformBlock];
+    for (int s = 0; s < S; s++) {
+      int previous = frames_[oldest][s];
+      bits.put((uint16_t)previous, 16);
+      for (int first = 1; first < frameCount; first += waveformBlock) {
+        int length = frameCount - first < waveformBlock ? frameCount - first : waveformBlock;
+        uint64_t total = 0;
+        for (int i = 0; i < length; i++) {
+          int value = frames_[(oldest + first + i) % capacity][s];
+          int32_t difference = value - previous;
+          block[i] = ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+          total += block[i];
+          previous = value;
+        }
+        int k = 0;
+        while (k < 15 && ((uint64_t)length << (k + 1)) <= total) k++;
+        bits.put((uint32_t)k, 4);
+        for (int i = 0; i < length; i++) {
+          uint32_t quotient = block[i] >> k;
+          if (quotient >= (uint32_t)waveformEscape) {
+            bits.putOnes(waveformEscape);
+            bits.put(block[i], waveformEscapeBits);
+          } else {
+            bits.putOnes((int)quotient);
+            bits.put(0, 1);
+            bits.put(block[i], k);
+          }
+        }
+      }
+    }
+    size_t written = bits.finish();
+    return bits.overflow() ? 0 : waveformHeaderBytes + written;
+  }
+
+private:
+  static void putLe16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+  }
+
+  int16_t frames_[capacity][S];
+  int index_;
+  int count_;
+  int postRemaining_;  // frames still to record after the trigger; -1 armed, 0 complete
+  int triggerCount_;  // frames in the ring at the trigger, the trigger frame included
+  uint32_t lastTimeMs_;
+  uint32_t triggerTimeMs_;
+  uint8_t burstType_;
+};
+
+typedef BasicWaveformCapture<numSensors> WaveformCapture;
+
+// One encoded capture handed from the analysis task to the uplink. The
+// analysis side fills it only while ready is false; the uplink clears ready
+// once the capture has been delivered.
+struct WaveformUpload {
+  WaveformUpload() : ready(false), size(0) {}
+
+  std::atomic<bool> ready;
+  uint32_t size;
+  uint8_t bytes[WaveformCapture::maxBytes];
+};
+
+} // namespace leakdsp
+
+#endif // LEAKDSP_WAVEFORM_CAPTURE_H